@@ -0,0 +1,14 @@
+#!/bin/bash
+# test_overhead's test_OS_malloc with glibc malloc and with libfast_mem_pool_preload.so
+# usage: ./bench_preload.sh [threads count]
+# FMP_* environment variables (FMP_PROVISION, FMP_MAX_SIZE ..) are passed to the preloaded run
+THREADS=${1:-2}
+BIN_DIR=$(cd "$(dirname "$0")" && pwd)/../fast_mem_pool_bin
+mkdir -p CMakeWorkDir_toDelete
+cd CMakeWorkDir_toDelete
+cmake -DCMAKE_BUILD_TYPE=Release .. > /dev/null || exit 1
+cmake --build . --target test_overhead.exe fast_mem_pool_preload || exit 1
+echo "=== glibc malloc ==="
+"$BIN_DIR/test_overhead.exe" "$THREADS" 0 OS_malloc
+echo "=== LD_PRELOAD=libfast_mem_pool_preload.so ==="
+LD_PRELOAD="$BIN_DIR/libfast_mem_pool_preload.so" "$BIN_DIR/test_overhead.exe" "$THREADS" 0 OS_malloc
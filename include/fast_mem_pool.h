@@ -15,6 +15,16 @@
 #include <algorithm>
 #include <string.h>
 #include <stdexcept>
+#include <limits>
+#include <thread>
+#include <vector>
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#define FastMemPool_PMR
+#endif
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#endif
 
 #if defined(Debug)
 #include <string>
@@ -37,6 +47,13 @@
 #ifndef DEF_Do_OS_malloc
 #define DEF_Do_OS_malloc  true
 #endif
+#ifndef DEF_Cache_line_Bytes
+#define DEF_Cache_line_Bytes  64
+#endif
+// Epochs of fmalloc_epoch() alive at the same time:
+#ifndef DEF_Epoch_Slots
+#define DEF_Epoch_Slots  8
+#endif
 #if defined(DEF_Auto_deallocate)
 #ifndef Debug
 #include <set>
@@ -44,7 +61,186 @@
 //#include <iostream>
 #endif
 #endif
+#if defined(DEF_Heap_profile)
+#include "fast_mem_pool_profiler.h"
+#endif
+#if defined(DEF_Alloc_trace)
+#include "fast_mem_pool_tracer.h"
+#endif
+#if defined(DEF_Pool_registry)
+#include "fast_mem_pool_registry.h"
+#endif
+#if defined(DEF_Headerless_small)
+#if !defined(DEF_Leaf_mmap)
+#error "DEF_Headerless_small needs DEF_Leaf_mmap: small leaves are found by masking pointers inside the leaves range"
+#endif
+// Leaves (from the same mmap'ed range) for headerless small allocations:
+#ifndef DEF_Small_Leaf_Cnt
+#define DEF_Small_Leaf_Cnt  16
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#elif defined(DEF_Small_bitmap)
+#error "DEF_Small_bitmap is the slot search of DEF_Headerless_small"
+#endif
+#if defined(DEF_Buddy_medium)
+// Smallest block of the buddy leaves (power of 2), allocations from it (with AllocHeader) up to a leaf are buddy blocks:
+#ifndef DEF_Buddy_Min_Bytes
+#define DEF_Buddy_Min_Bytes  4096
+#endif
+#endif
+#if defined(DEF_Rseq_slots)
+#if !defined(DEF_Leaf_mmap)
+#error "DEF_Rseq_slots needs DEF_Leaf_mmap: the leaf of a slot allocation is found by a range compare"
+#endif
+// Bytes a per-CPU slot takes from a leaf at once (power of 2, aligned chunks):
+#ifndef DEF_Rseq_Chunk_Bytes
+#define DEF_Rseq_Chunk_Bytes  4096
+#endif
+// Bigger allocations skip the per-CPU slots:
+#ifndef DEF_Rseq_Max_Bytes
+#define DEF_Rseq_Max_Bytes  1024
+#endif
+#ifndef DEF_Rseq_Max_Cpus
+#define DEF_Rseq_Max_Cpus  256
+#endif
+// The rseq critical section is x86_64 assembly, the thread registration is done by glibc (2.35+):
+#if defined(__x86_64__) && defined(__linux__) && defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 35)
+#define FMP_RSEQ  1
+#include <sys/rseq.h>
+#include <sched.h>
+#endif
+#endif
+#if defined(DEF_Leaf_mmap) && defined(_WIN32)
+#include <windows.h>
+#endif
+#if defined(DEF_Contention_profile)
+#include <string>
+#include <sstream>
+#include <iomanip>
+#endif
+#if defined(DEF_NUMA)
+// Max leaf groups (NUMA nodes):
+#ifndef DEF_NUMA_Max_Nodes
+#define DEF_NUMA_Max_Nodes  8
+#endif
+// Leaf groups: 0 - one per online NUMA node, N - emulate N nodes (testable on a single node machine):
+#ifndef DEF_NUMA_Nodes
+#define DEF_NUMA_Nodes  0
+#endif
+// A thread reads its CPU and node again after this many allocations (a migrated thread is late by so many):
+#ifndef DEF_NUMA_Refresh
+#define DEF_NUMA_Refresh  64
+#endif
+#if defined(__linux__)
+#include <unistd.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <fstream>
+#endif
+#endif
+#if defined(DEF_Alloc_site)
+#include <vector>
+#ifndef DEF_Alloc_site_Cnt
+#define DEF_Alloc_site_Cnt  4096
+#endif
+
+/*
+ * FastMemPoolSites
+ * Process wide table of allocation sites (__FILE__, __LINE__).
+ * Each FMALLOC call place registers itself once (static local) and then
+ * only stamps its compact site_id into the AllocHeader.
+ * site_id == 0 means "unknown site" (plain fmalloc() call or table overflow).
+ */
+struct FastMemPoolSite {
+  std::atomic<const char *>  file  {  nullptr  };
+  int  line  {  0  };
+};
+
+class FastMemPoolSites
+{
+public:
+  static int  register_site(const char *file, int line)
+  {
+    const int  site_id  =  counter().fetch_add(1, std::memory_order_relaxed);
+    if (site_id  >=  DEF_Alloc_site_Cnt)  {  return  0;  }
+    FastMemPoolSite  &site  =  table()[site_id];
+    site.line  =  line;
+    site.file.store(file, std::memory_order_release);
+    return  site_id;
+  }
+
+  // Returns nullptr if site_id is unknown:
+  static const FastMemPoolSite  * site(int site_id)
+  {
+    if (site_id  <=  0  ||  site_id  >=  DEF_Alloc_site_Cnt)  {  return  nullptr;  }
+    const FastMemPoolSite  &site  =  table()[site_id];
+    if (!site.file.load(std::memory_order_acquire))  {  return  nullptr;  }
+    return  &site;
+  }
+
+private:
+  static std::atomic<int>  & counter()
+  {  // starts from 1 because 0 is "unknown site":
+    static std::atomic<int>  cnt  {  1  };
+    return  cnt;
+  }
+
+  static FastMemPoolSite  * table()
+  {
+    static FastMemPoolSite  sites[DEF_Alloc_site_Cnt];
+    return  sites;
+  }
+};
+
+/**
+ * @brief FMALLOC_SITE_ID - registers __FILE__/__LINE__ once, then just returns the site_id
+ */
+#define FMALLOC_SITE_ID() \
+   ([]() { static const int  fmalloc_site_id = FastMemPoolSites::register_site(__FILE__, __LINE__); return fmalloc_site_id; }())
+
+// Live bytes owned by one allocation site, see FastMemPool::dump_live_by_site():
+struct FastMemPoolSiteStat {
+  const char  *file;  // nullptr == unknown site
+  int  line;
+  std::size_t  live_bytes;
+  std::size_t  live_cnt;
+};
+#endif
+
+
+/*
+ * FastMemPoolProvision
+ * How the constructor provisions the leaves:
+ */
+#if defined(DEF_NUMA)
+// FastMemPool::numa_stats() item:
+struct FastMemPoolNodeStat {
+  int  node;
+  int  leaves;
+  int  free_leaves;
+  int64_t  available_bytes;
+  // allocations of the node's threads served by the leaves of the other nodes:
+  uint64_t  remote_allocs;
+  // allocations of the node's threads that went to OS malloc:
+  uint64_t  os_allocs;
+};
+#endif
+
+enum class FastMemPoolProvision {
+  Eager,  // every leaf is allocated by the constructor, pages fault on the first writes
+  Lazy,  // a leaf is provisioned when fmalloc runs out of the provisioned ones: fast startup
+  Prefault,  // leaves are populated by the constructor (MAP_POPULATE, MADV_POPULATE_WRITE or touch): no faults in steady state
+  Pretouch  // helper threads touch the pages of all leaves in parallel: for multi GiB pools
+};
 
+// Expected lifetime of an allocation, the leaf group of fmalloc(size, hint) (if defined (DEF_Lifetime_groups)):
+enum class FastMemPoolLifetimeHint {
+  Short,  // request / frame scoped churn: the first half of the leaves
+  Medium,  // fmalloc(size) without a hint: a quarter of the leaves
+  Long  // caches, long living objects that would pin a leaf of the churn: the last quarter
+};
 
 /*
  * FastMemPool
@@ -78,6 +274,28 @@
  *  - it is possible to maintain a register of allocations for debugging (included in the code at compile time if defined (Debug))
  *  For example: upon repeated deallocation, in Exception it will tell where the first one happened:
  * "FastMemPool::ffreed: this pointer has already been freed from: test_exe.cpp, at 9  line, in free1"
+ *  - sampling heap profiler with pprof compatible output (if defined (DEF_Heap_profile)),
+ *  see fast_mem_pool_profiler.h: fast_mem_pool_profiler.save_heap_profile("heap.prof")
+ *  - fmalloc/ffree event tracer with Chrome/Perfetto JSON export (if defined (DEF_Alloc_trace)),
+ *  see fast_mem_pool_tracer.h: fast_mem_pool_tracer.chrome_trace_json()
+ *  - contention profiling of the leaf scan and atomics (if defined (DEF_Contention_profile)),
+ *  see contention_report()
+ *  - cache line isolated Leaf states and cur_leaf against false sharing (if defined (DEF_Cache_line_isolation))
+ *  - all leaves in one mmap'ed range, ownership is a range compare (if defined (DEF_Leaf_mmap))
+ *  - headerless small allocations (<= 256 bytes) from size class leaves, the leaf is found by
+ *  pointer masking (if defined (DEF_Headerless_small), only pools with Leaf_Size_Bytes a power of 2 >= 1024),
+ *  the requested size is kept in a slack byte of the leaf, so check_access stays exact
+ *  - NUMA aware leaves (if defined (DEF_NUMA)): one leaf group per node bound with mbind,
+ *  fmalloc takes the leaves of the caller's node first, then the other nodes, see numa_stats()
+ *  - per-CPU bump slots in front of the leaves (if defined (DEF_Rseq_slots)): a restartable sequence
+ *  allocates from the chunk of the current CPU without a lock prefix, the leaves are the fallback
+ *  - process-wide registry of the leaves of all pools (if defined (DEF_Pool_registry)),
+ *  see fast_mem_pool_registry.h: fm_free(ptr) without knowing the owner pool
+ *  - lifetime leaf groups (if defined (DEF_Lifetime_groups)): fmalloc(size, FastMemPoolLifetimeHint::Short)
+ *  allocates in its own leaves with its own cursor, a long living object does not pin a leaf of the churn
+ *  - buddy leaves for medium allocations (if defined (DEF_Buddy_medium), only pools with Leaf_Size_Bytes
+ *  a power of 2 >= 2 * DEF_Buddy_Min_Bytes): blocks from DEF_Buddy_Min_Bytes up to a leaf are split and
+ *  coalesced in O(log n), a freed block is reused at once, a leaf goes back to the pool when it coalesces whole
  *
 */
 template<int Leaf_Size_Bytes = DEF_Leaf_Size_Bytes, int Leaf_Cnt = DEF_Leaf_Cnt,
@@ -94,52 +312,134 @@ public:
    */
   void  * fmalloc(std::size_t  allocation_size)
   {
+    return  fmalloc_grow(allocation_size,  nullptr);
+  }
+
+  using  LifetimeHint  =  FastMemPoolLifetimeHint;
+  /**
+   * @brief fmalloc
+   * Allocation in the leaf group of the expected lifetime (if defined (DEF_Lifetime_groups)),
+   * the other groups are used when it is depleted, then OS malloc. Without DEF_Lifetime_groups it is fmalloc(size).
+   * (headerless small allocations and the per-CPU slots have their own leaves and ignore the hint)
+   * @param allocation_size  -  volume to allocate
+   * @param hint  -  Short, Medium (as fmalloc(size)) or Long
+   * @return - allocation ptr
+   */
+  void  * fmalloc(std::size_t  allocation_size,  LifetimeHint  hint)
+  {
+    return  fmalloc_grow(allocation_size,  nullptr,  hint);
+  }
+
+  /**
+   * @brief fmalloc_at_least
+   * fmalloc that may give more than asked for free: the rest of the cache line below the allocation
+   * or the leaf tail (< Average_Allocation) that would be left behind, a small allocation gets its
+   * whole size class. The actual size is the allocation size (AllocHeader::size, check_access, ffree).
+   * @param min_size  -  volume to allocate at least
+   * @param actual_size  -  [out] the allocated volume >= min_size
+   * @param hint  -  lifetime group (see fmalloc(size, hint))
+   * @return - allocation ptr
+   */
+  void  * fmalloc_at_least(std::size_t  min_size,  std::size_t  *actual_size,  LifetimeHint  hint  =  LifetimeHint::Medium)
+  {
+    return  fmalloc_grow(min_size,  actual_size,  hint);
+  }
+
+private:
+  // actual_size == nullptr: exactly allocation_size
+  void  * fmalloc_grow(std::size_t  allocation_size,  std::size_t  *actual_size,  LifetimeHint  hint  =  LifetimeHint::Medium)
+  {
+    if (actual_size)  {  *actual_size  =  allocation_size;  }
+#if defined(DEF_Headerless_small)
+    if (Headerless_small  &&  allocation_size  <=  Small_Max_Bytes)
+    {  // no AllocHeader, if the small leaves are over the allocation goes the usual way:
+      if (actual_size)  {  *actual_size  =  small_class_size(small_class(allocation_size));  }
+      void  *small  =  small_malloc(actual_size  ?  *actual_size  :  allocation_size);
+      if (small)
+      {
+  #if defined(DEF_Heap_profile)
+        fast_mem_pool_profiler.on_alloc(small,  actual_size  ?  *actual_size  :  allocation_size);
+  #endif
+  #if defined(DEF_Alloc_trace)
+        fast_mem_pool_tracer.on_fmalloc(actual_size  ?  *actual_size  :  allocation_size,  own_leaf_id(small),  FastMemPoolTracePath::Fast);
+  #endif
+        return  small;
+      }
+      if (actual_size)  {  *actual_size  =  allocation_size;  }
+    }
+#endif
+    // fmalloc_at_least: bytes given over real_size by the leaf
+    int  grown  =  0;
     // Allocation will include a header with service information:
     const int  real_size = allocation_size  +  sizeof(AllocHeader);
-    // Starting leaf for finding the allocation place:
-    const int start_leaf = cur_leaf.load(std::memory_order_relaxed);
-    // Selected leaf identifier:
-    int leaf_id = start_leaf;
-    // Resulting allocation:
-    char  *re  =  nullptr;
-
+    // Selected leaf identifier and the leaf where the search started:
+    int  leaf_id  =  0;
+    int  start_leaf  =  0;
+    bool  rotated  =  false;
+#if defined(DEF_NUMA)
+    const int  node  =  current_numa_node();
+#endif
     /*
-      Exit the loop at the end of the loop when we meet start_leaf again.
       If it is impossible to make an allocation in your own memory pool,
       an escalation to OS malloc will occur, but the access control functionality will remain operational.
-   */
-    do {
-      const int available  =  leaf_array[leaf_id].available.load(std::memory_order_acquire);
-      if (available  >=  real_size)
-      {
-        // we reserve memory (the buffer is distributed from the end with a bite):
-        const int  available_after  =  leaf_array[leaf_id].available.fetch_sub(real_size, std::memory_order_acq_rel)  -  real_size;
-        // and if successful, a positive number should have returned,
-        // otherwise we would have broken through the bottom of the buffer:
-        if (available_after >= 0)
-        {  // the resulting distribution address is easy to obtain, because it starts immediately
-          // after "available", since addressing from &[0] then this is "buf + available":
-          re  =  leaf_array[leaf_id].buf + available_after;
-          if (available_after < Average_Allocation)
-          {  // Let's tell the rest of the threads to use a different memory page:
-            const int next_id = start_leaf + 1;
-            if (next_id >= Leaf_Cnt)
-            {
-              cur_leaf.store(0, std::memory_order_release);
-            } else {
-              cur_leaf.store(next_id, std::memory_order_release);
-            }
-          }
-          break; // finished the search, return the allocation pointer
-        }
+    */
+    char  *re  =  nullptr;
+#if defined(DEF_Buddy_medium)
+    // a medium allocation takes a buddy block, the bump leaves are the fallback:
+    if (Buddy_medium  &&  allocation_size  +  sizeof(AllocHeader)  >=  static_cast<std::size_t>(Buddy_Min_Bytes)
+        &&  allocation_size  +  sizeof(AllocHeader)  <=  static_cast<std::size_t>(Leaf_Size_Bytes))
+    {
+      re  =  buddy_alloc(real_size,  leaf_id,  actual_size  ?  &grown  :  nullptr);
+      start_leaf  =  leaf_id;
+    }
+    if (!re)
+#endif
+#if defined(DEF_Rseq_slots)
+    // the slot of the current CPU first:
+    if (Rseq_slots  &&  allocation_size  <=  Rseq_Max_Bytes)
+    {
+      re  =  cpu_slot_alloc(real_size);
+      if (re)  {  leaf_id  =  start_leaf  =  own_leaf_id(re);  }
+    }
+    if (!re)
+#endif
+    {
+#if defined(DEF_NUMA)
+      // leaves of the caller's node first, then the other nodes:
+      re  =  lifetime_alloc(numa_node[node].first_leaf,  numa_node[node].leaf_cnt,  numa_node[node].cur_leaf,
+                            numa_node[node].lifetime_cur,  hint,  real_size,  leaf_id,  start_leaf,  rotated,
+                            actual_size  ?  &grown  :  nullptr);
+      for (int  i  =  1;  !re  &&  i  <  numa_nodes;  ++i)
+      {
+        NumaNode  &remote  =  numa_node[(node  +  i)  %  numa_nodes];
+        re  =  lifetime_alloc(remote.first_leaf,  remote.leaf_cnt,  remote.cur_leaf,  remote.lifetime_cur,  hint,
+                              real_size,  leaf_id,  start_leaf,  rotated,  actual_size  ?  &grown  :  nullptr);
+        if (re)  {  numa_node[node].remote_allocs.fetch_add(1,  std::memory_order_relaxed);  }
       }
-      ++leaf_id;
-      if (Leaf_Cnt == leaf_id)  {  leaf_id  =  0;  }
-    } while (leaf_id  !=  start_leaf);
+#else
+      re  =  lifetime_alloc(0,  Leaf_Cnt,  cur_leaf,  lifetime_cur,  hint,  real_size,  leaf_id,  start_leaf,  rotated,
+                            actual_size  ?  &grown  :  nullptr);
+#endif
+    }
+#if defined(DEF_Alloc_trace)
+    FastMemPoolTracePath  trace_path  =  rotated  ?  FastMemPoolTracePath::Leaf_rotate  :  FastMemPoolTracePath::Fast;
+#endif
+
+#if defined(DEF_NUMA)
+    if (!re  &&  provision_leaf(node))
+#else
+    if (!re  &&  provision_leaf())
+#endif
+    {  // FastMemPoolProvision::Lazy: one more leaf is ready, search again
+      return  fmalloc_grow(allocation_size,  actual_size,  hint);
+    }
 
     bool  do_OS_malloc  =  !re;
     if  (do_OS_malloc)
     {  // Now the escalation to OS malloc will occur:
+#if defined(DEF_NUMA)
+      numa_node[node].os_allocs.fetch_add(1,  std::memory_order_relaxed);
+#endif
       if (Do_OS_malloc)
       {
         // Паттерн "Chain of responsibility" в действии:
@@ -171,13 +471,206 @@ public:
         head->leaf_id  =  leaf_id;
         head->tag_this = ((uint64_t)this) + leaf_id;
       }
+      allocation_size  +=  grown;
+      if (actual_size)  {  *actual_size  =  allocation_size;  }
       head->size  =  allocation_size;
+#if defined(DEF_Alloc_site)
+      head->site_id  =  0;
+#endif
+#if defined(DEF_Heap_profile)
+      fast_mem_pool_profiler.on_alloc(re + sizeof(AllocHeader),  allocation_size);
+#endif
+#if defined(DEF_Alloc_trace)
+      if (do_OS_malloc)
+      {
+        trace_path  =  FastMemPoolTracePath::OS_malloc;
+      }  else if (FastMemPoolTracePath::Fast  ==  trace_path  &&  leaf_id  !=  start_leaf)
+      {
+        trace_path  =  FastMemPoolTracePath::Leaf_switch;
+      }
+      fast_mem_pool_tracer.on_fmalloc(allocation_size,  head->leaf_id,  trace_path);
+#endif
       return  (re + sizeof(AllocHeader));
     }
 
+#if defined(DEF_Alloc_trace)
+    fast_mem_pool_tracer.on_fmalloc(allocation_size,  OS_malloc_id,  FastMemPoolTracePath::Failed);
+#endif
     return  nullptr;
-  }  // fmalloc
+  }  // fmalloc_grow
+
+public:
+
+#if defined(DEF_Alloc_site)
+  /**
+   * @brief fmalloc_site
+   * fmalloc that remembers the allocation site (see FMALLOC_SITE_ID())
+   * @param allocation_size  -  volume to allocate
+   * @param site_id  -  id from FastMemPoolSites::register_site()
+   * @param hint  -  lifetime group (see fmalloc(size, hint))
+   * @return - allocation ptr
+   */
+  void  * fmalloc_site(std::size_t  allocation_size,  int  site_id,  LifetimeHint  hint  =  LifetimeHint::Medium)
+  {
+    void  *re  =  fmalloc(allocation_size,  hint);
+#if defined(DEF_Headerless_small)
+    if (re  &&  !(Headerless_small  &&  is_small(re)))
+#else
+    if (re)
+#endif
+    {
+      reinterpret_cast<AllocHeader  *>(static_cast<char  *>(re)  -  sizeof(AllocHeader))->site_id  =  site_id;
+    }
+    return  re;
+  }
+
+  /**
+   * @brief dump_live_by_site
+   * Walks the allocations of every leaf and sums the live bytes per allocation site.
+   * Allocations made through OS malloc are not walked.
+   * It is a diagnostic snapshot: the walk of a leaf stops at the first header
+   * that is still being written by a concurrent fmalloc.
+   * The leaves of a ScopedArena are walked from the cursor of the arena, the leaves of an epoch
+   * from the slot cursor (the passed ones from their last cursor).
+   * With DEF_Rseq_slots it calls release_cpu_slots() first.
+   * @return - per site statistics sorted by live_bytes (biggest first)
+   */
+  std::vector<FastMemPoolSiteStat>  dump_live_by_site()
+  {
+    // (DEF_Rseq_slots) the chunks go back to the leaves: their free rest becomes a padding header
+    release_cpu_slots();
+    std::vector<FastMemPoolSiteStat>  re;
+    std::vector<int>  site_to_stat(DEF_Alloc_site_Cnt,  -1);
+    // the allocations of leaf i that lie one after another in [cur, end):
+    auto  walk  =  [&](int  i,  char  *cur,  char  *end)
+    {
+      while (cur  +  sizeof(AllocHeader)  <=  end)
+      {
+        AllocHeader  *head  =  reinterpret_cast<AllocHeader  *>(cur);
+        if (head->size  <  0  ||  head->size  >=  Leaf_Size_Bytes)  {  break;  }
+        char  *next  =  cur  +  sizeof(AllocHeader)  +  head->size;
+        if (next  >  end)  {  break;  }
+        if (i  ==  head->leaf_id  &&  ((uint64_t)this)  ==  (head->tag_this  -  head->leaf_id))
+        {  // live allocation:
+          int  site_id  =  head->site_id;
+          if (!FastMemPoolSites::site(site_id))  {  site_id  =  0;  }
+          int  &stat_id  =  site_to_stat[site_id];
+          if (stat_id  <  0)
+          {
+            stat_id  =  static_cast<int>(re.size());
+            const FastMemPoolSite  *site  =  FastMemPoolSites::site(site_id);
+            re.push_back({site  ?  site->file.load(std::memory_order_acquire)  :  nullptr,
+                          site  ?  site->line  :  0,  0,  0});
+          }
+          re[stat_id].live_bytes  +=  head->size;
+          ++re[stat_id].live_cnt;
+        }
+        cur  =  next;
+      }  // while
+    };
+    for (int  i  =  0;  i  <  Leaf_Cnt;  ++i)
+    {
+      char  *buf  =  leaf_buf[i];
+      int  available  =  state_available(leaf_array[i].state.load(std::memory_order_acquire));
+      if (!buf)  {  continue;  }
+      // a ScopedArena or epoch leaf looks depleted, its cursor is kept apart:
+      if (const int  slot_tag  =  leaf_epoch[i].load(std::memory_order_acquire))
+      {  // the current leaf of the epoch is in the slot cursor, a passed one keeps its last cursor:
+        const uint64_t  cursor  =  epoch_slots[slot_tag  -  1].cursor.load(std::memory_order_acquire);
+        if (i  ==  static_cast<int>(cursor  >>  32)  -  1)
+        {
+          available  =  static_cast<int>(static_cast<uint32_t>(cursor));
+        }  else  {
+          const int  passed  =  private_cursor[i].load(std::memory_order_acquire);
+          // (a leaf that is just claimed has nothing yet)
+          available  =  passed  ?  passed  -  1  :  Leaf_Size_Bytes;
+        }
+      }  else if (const int  cursor  =  private_cursor[i].load(std::memory_order_acquire))  {
+        available  =  cursor  -  1;
+      }
+  #if defined(DEF_Buddy_medium)
+      if (buddy_leaf(i))
+      {  // each allocated block starts with its allocation (or the padding of fmalloc_aligned):
+        buddy_lock_take();
+        for (int  idx  =  0;  idx  <  Buddy_Blocks;  ++idx)
+        {
+          const int  tag  =  buddy_tag[i][idx];
+          if (tag  &&  !(tag  &  Buddy_Free_Tag))
+          {
+            walk(i,  buf  +  idx  *  Buddy_Min_Bytes,  buf  +  (idx  +  (1  <<  (tag  -  1)))  *  Buddy_Min_Bytes);
+          }
+        }
+        buddy_lock.store(false,  std::memory_order_release);
+        continue;
+      }
+  #endif
+      // allocations are cut from the end of the leaf, so they lie one after another from buf + available:
+      walk(i,  buf  +  available,  buf  +  Leaf_Size_Bytes);
+    }
+    std::sort(re.begin(),  re.end(),  [](const FastMemPoolSiteStat  &lh,  const FastMemPoolSiteStat  &rh) {
+      return  lh.live_bytes  >  rh.live_bytes;  });
+    return  re;
+  }  // dump_live_by_site
+#endif
+
 
+  /**
+   * @brief fmalloc_aligned
+   * fmalloc with the allocation on the alignment, the header keeps exactly allocation_size
+   * (ffree(ptr, allocation_size) is right). In a pool whose cuts are multiples of the alignment
+   * (sizes rounded to it, as FastMemPoolObject and FastMemPoolResource do) fmalloc is aligned already,
+   * else a bigger block is cut and the paddings in front of the allocation and behind it go back
+   * to the leaf at once. The OS malloc fallback is aligned too.
+   * @param allocation_size  -  volume to allocate
+   * @param alignment  -  power of 2
+   * @return - allocation ptr, nullptr as fmalloc
+   */
+  void  * fmalloc_aligned(std::size_t  allocation_size,  std::size_t  alignment)
+  {
+    char  *re  =  static_cast<char  *>(fmalloc(allocation_size));
+    if (!re  ||  0  ==  (reinterpret_cast<uintptr_t>(re)  &  (alignment  -  1)))  {  return  re;  }
+    ffree(re,  allocation_size);
+    // the header moves by 0 or >= sizeof(AllocHeader) (the step keeps the alignment) and the tail
+    // behind the allocation is >= sizeof(AllocHeader): a leaf stays a chain of headers
+    const std::size_t  step  =  (sizeof(AllocHeader)  +  alignment  -  1)  &  ~(alignment  -  1);
+    std::size_t  padded  =  allocation_size  +  step  +  2  *  sizeof(AllocHeader)  -  1;
+#if defined(DEF_Headerless_small)
+    // (a headerless object has no header to move)
+    if (Headerless_small)  {  padded  =  std::max(padded,  Small_Max_Bytes  +  1);  }
+#endif
+    re  =  static_cast<char  *>(fmalloc(padded));
+    if (!re)  {  return  nullptr;  }
+    AllocHeader  *head  =  reinterpret_cast<AllocHeader  *>(re  -  sizeof(AllocHeader));
+    if (OS_malloc_id  ==  head->leaf_id)
+    {  // free() needs the header where malloc put it:
+      ffree(re);
+      return  os_malloc_aligned(allocation_size,  alignment);
+    }
+    std::size_t  shift  =  (0  -  reinterpret_cast<uintptr_t>(re))  &  (alignment  -  1);
+    if (0  <  shift  &&  shift  <  sizeof(AllocHeader))  {  shift  +=  step;  }
+    const std::size_t  tail  =  padded  -  shift  -  allocation_size;
+    AllocHeader  moved  =  *head;
+    moved.size  =  static_cast<int>(allocation_size);
+    // the paddings look like freed allocations:
+    if (shift)
+    {
+      head->tag_this  =  0;
+      head->leaf_id  =  0;
+      head->size  =  static_cast<int>(shift  -  sizeof(AllocHeader));
+    }
+    AllocHeader  *behind  =  reinterpret_cast<AllocHeader  *>(re  +  shift  +  allocation_size);
+    behind->tag_this  =  0;
+    behind->leaf_id  =  0;
+    behind->size  =  static_cast<int>(tail  -  sizeof(AllocHeader));
+    *reinterpret_cast<AllocHeader  *>(re  +  shift  -  sizeof(AllocHeader))  =  moved;
+    // (a buddy block goes back whole, with its paddings)
+    if (!buddy_leaf(moved.leaf_id))  {  leaf_release(moved.leaf_id,  static_cast<int>(shift  +  tail));  }
+#if defined(DEF_Heap_profile)
+    fast_mem_pool_profiler.on_free(re);
+    fast_mem_pool_profiler.on_alloc(re  +  shift,  allocation_size);
+#endif
+    return  re  +  shift;
+  }  // fmalloc_aligned
 
   /**
    * @brief ffree  -  function to release allocation instead of "free"
@@ -185,42 +678,115 @@ public:
    */
   void  ffree(void  *ptr)
   {
+    ffree_sized(ptr,  -1);
+  }
+
+  /**
+   * @brief ffree  -  sized release (operator delete(void *, std::size_t)), the leaf is
+   * accounted with allocation_size instead of the header size (Debug checks they match)
+   * @param ptr  -  allocation pointer obtained earlier via fmaloc (not fmalloc_aligned)
+   * @param allocation_size  -  the size given to fmalloc
+   */
+  void  ffree(void  *ptr,  std::size_t  allocation_size)
+  {
+    ffree_sized(ptr,  allocation_size  <  static_cast<std::size_t>(Leaf_Size_Bytes)
+                      ?  static_cast<int>(allocation_size)  :  Leaf_Size_Bytes);
+  }
+
+private:
+  // known_size < 0: read the size from the header
+  void  ffree_sized(void  *ptr,  int  known_size)
+  {
+#if defined(DEF_Heap_profile)
+    fast_mem_pool_profiler.on_free(ptr);
+#endif
+#if defined(DEF_Headerless_small)
+    if (Headerless_small  &&  is_small(ptr))
+    {
+      if (!small_free(ptr))
+      {  // not a live small object of ours (double free or a pointer into the middle of the object):
+        if constexpr (Raise_Exeptions)
+        {
+            throw std::range_error("FastMemPool::ffree: this is someone else's allocation");
+        }
+      }
+      return;
+    }
+#endif
     // Rewind back to get the AllocHeader:
     char  *to_free  =  static_cast<char  *>(ptr)  -  sizeof(AllocHeader);
     AllocHeader  *head  =  reinterpret_cast<AllocHeader  *>(to_free);
-    if  (0 <= head->size  &&  head->size < Leaf_Size_Bytes
+#if defined(DEF_Leaf_mmap)
+    // range compare first, the header is read only if it lies in our leaves:
+    const int  own_leaf  =  own_leaf_id(to_free);
+    const int  size  =  known_size  <  0  &&  0  <=  own_leaf  ?  head->size  :  known_size;
+    if  (0 <= own_leaf  &&  own_leaf == head->leaf_id
+         &&  0 <= size  &&  size < Leaf_Size_Bytes
+         && ((uint64_t)this) == (head->tag_this - head->leaf_id))
+#else
+    const int  size  =  known_size  <  0  ?  head->size  :  known_size;
+    if  (0 <= size  &&  size < Leaf_Size_Bytes
          &&  0 <= head->leaf_id  &&  head->leaf_id < Leaf_Cnt
          && ((uint64_t)this) == (head->tag_this - head->leaf_id)
-         &&  leaf_array[head->leaf_id].buf)
+         &&  leaf_buf[head->leaf_id])
+#endif
     {  //  ok this is my allocation
-      const int  real_size = head->size  +  sizeof(AllocHeader);
-      const int  deallocated  =  leaf_array[head->leaf_id].deallocated.fetch_add(real_size, std::memory_order_acq_rel)  +  real_size;
-      int  available  =  leaf_array[head->leaf_id].available.load(std::memory_order_acquire);
-      if (deallocated  == (Leaf_Size_Bytes - available))
-      {  // everything that was allocated is now returned, we will try, carefully, reset the Leaf
-        if (leaf_array[head->leaf_id].available.compare_exchange_strong(available,  Leaf_Size_Bytes))
+#if defined(Debug)
+      if (size  !=  head->size)
+      {
+        if constexpr (Raise_Exeptions)
         {
-          leaf_array[head->leaf_id].deallocated  -=  deallocated;
+            throw std::range_error("FastMemPool::ffree: the size is not the allocation size");
         }
+        return;
+      }
+#endif
+#if defined(DEF_Buddy_medium)
+      if (buddy_leaf(head->leaf_id))
+      {
+        const int  leaf_id  =  head->leaf_id;
+        // the header is cleared first: the block may be taken again at once
+        memset(head,  0,  sizeof(AllocHeader));
+  #if defined(DEF_Alloc_trace)
+        const bool  reset  =  buddy_release(to_free,  leaf_id);
+        fast_mem_pool_tracer.on_ffree(size,  leaf_id,
+          reset  ?  FastMemPoolTracePath::Leaf_reset  :  FastMemPoolTracePath::Fast);
+  #else
+        buddy_release(to_free,  leaf_id);
+  #endif
+        return;
       }
+#endif
+      const int  real_size = size  +  sizeof(AllocHeader);
+#if defined(DEF_Alloc_trace)
+      const bool  reset  =  leaf_release(head->leaf_id,  real_size);
+      fast_mem_pool_tracer.on_ffree(size,  head->leaf_id,
+        reset  ?  FastMemPoolTracePath::Leaf_reset  :  FastMemPoolTracePath::Fast);
+#else
+      leaf_release(head->leaf_id,  real_size);
+#endif
 
       // Cleanup so that unique TAG_my_alloc will be keep unique in RAM:
-      memset(head,  0,  sizeof(AllocHeader));
-    }  else if (TAG_OS_malloc  ==  head->tag_this
-         &&  OS_malloc_id  ==  head->leaf_id
-         &&  head->size > 0   )
+      // (size stays: ScopedArena::rollback() and dump_live_by_site() step over the freed allocation with it)
+      head->tag_this  =  0;
+      head->leaf_id  =  0;
+    }  else if (os_header(head))
     {  // ok, это OS malloc
+#if defined(DEF_Alloc_trace)
+      fast_mem_pool_tracer.on_ffree(head->size,  OS_malloc_id,  FastMemPoolTracePath::OS_malloc);
+#endif
+      void  *block  =  os_block(head);
       // Cleanup so that unique TAG_my_alloc will be keep unique in RAM:
       memset(head,  0,  sizeof(AllocHeader));
 #if defined(DEF_Auto_deallocate)
    #if not defined(Debug)
         {
           std::lock_guard<std::mutex>  lg(mut_set_alloc_info);
-          set_alloc_info.erase(head);
+          set_alloc_info.erase(block);
         }
   #endif
 #endif
-      free(head);
+      free(block);
     }  else  {
       // this is someone else's allocation, Exception
       if constexpr (Raise_Exeptions)
@@ -229,8 +795,9 @@ public:
       }
     }
     return;
-  }
+  }  // ffree_sized
 
+public:
   /**
    * @brief check_access  -  checking the accessibility of the target memory area
    * @param base_alloc_ptr - the assumed address of the base allocation from FastMemPool
@@ -243,14 +810,50 @@ public:
   bool  check_access(void  *base_alloc_ptr,  void  *target_ptr,  std::size_t  target_size)
   {
     bool  re  = false;
+#if defined(DEF_Headerless_small)
+    if (Headerless_small  &&  is_small(base_alloc_ptr))
+    {
+      const int  obj_size  =  small_live_size(base_alloc_ptr);
+      if (obj_size  <  0)
+      {
+        if constexpr (Raise_Exeptions)
+        {
+            throw std::range_error("FastMemPool::check_access: not  FastMemPool's allocation");
+        }
+        return  re;
+      }
+      // Let's check whether it has gone beyond the allocation limits:
+      char  *start  =  static_cast<char  *>(base_alloc_ptr);
+      char  *end  =  start  +  obj_size;
+      char  *target_start  =  static_cast<char  *>(target_ptr);
+      char  *target_end  =  target_start  +  target_size;
+      if  (start  <=  target_start  &&  target_end <= end)
+      {
+        re = true;
+      }  else  {
+        if constexpr (Raise_Exeptions)
+        {
+            throw std::range_error("FastMemPool::check_access: out of allocation");
+        }
+      }
+      return  re;
+    }
+#endif
     AllocHeader  *head  =  reinterpret_cast<AllocHeader  *>(static_cast<char  *>(base_alloc_ptr)  -  sizeof(AllocHeader));
+#if defined(DEF_Leaf_mmap)
+    const int  own_leaf  =  own_leaf_id(head);
+    if  (0 <= own_leaf  &&  own_leaf == head->leaf_id
+         &&  0 <= head->size  &&  head->size < Leaf_Size_Bytes
+         && ((uint64_t)this) == (head->tag_this - head->leaf_id))
+#else
     if  (0 <= head->size  &&  head->size < Leaf_Size_Bytes
          &&  0 <= head->leaf_id  &&  head->leaf_id < Leaf_Cnt
          && ((uint64_t)this) == (head->tag_this - head->leaf_id))
+#endif
     {  //  ok, this is FastMemPool allocation
       char  *start  =  static_cast<char  *>(base_alloc_ptr);
       char  *end  =  start  +  head->size;
-      char  *buf  =  leaf_array[head->leaf_id].buf;
+      char  *buf  =  leaf_buf[head->leaf_id];
       if (buf  &&  buf  <=  start  &&  (buf  +  Leaf_Size_Bytes) >= end)
       { // Let's check whether it has gone beyond the allocation limits:
         char  *target_start  =  static_cast<char  *>(target_ptr);
@@ -270,9 +873,7 @@ public:
             throw std::range_error("FastMemPool::check_access: out of Leaf");
         }
       } // elseif (!buf
-    }  else  if ( TAG_OS_malloc  ==  head->tag_this
-         &&  OS_malloc_id  ==  head->leaf_id
-         &&  head->size > 0 )
+    }  else  if (os_header(head))
     {
       // Let's check whether it has gone beyond the allocation limits:
       char  *start  =  static_cast<char  *>(base_alloc_ptr);
@@ -301,12 +902,59 @@ public:
   /**
    * @brief FastMemPool - construct
    */
-  FastMemPool()  noexcept
+  FastMemPool()  noexcept  :  FastMemPool(FastMemPoolProvision::Eager)
+  {
+  }
+
+  /**
+   * @brief FastMemPool - construct with the leaf provisioning policy
+   * @param provision  -  see FastMemPoolProvision
+   * @param pretouch_threads  -  helper threads for FastMemPoolProvision::Pretouch, 0 == hardware concurrency
+   */
+  explicit FastMemPool(FastMemPoolProvision  provision,  int  pretouch_threads  =  0)  noexcept
   {
+    const bool  lazy  =  FastMemPoolProvision::Lazy  ==  provision;
+    // the leaves are already populated by the mapping:
+    bool  populated  =  false;
+#if defined(DEF_NUMA)
+    numa_init(lazy);
+#endif
+#if defined(DEF_Leaf_mmap)
+    // One reservation for all leaves, leaf_id == (ptr - leaf_base) / Leaf_Size_Bytes:
+    // (with Leaf_Base_Align extra bytes to put leaf_base on the alignment)
+  #if defined(_WIN32)
+    leaf_map  =  static_cast<char *>(VirtualAlloc(nullptr,  Leaf_Map_Bytes,  MEM_RESERVE | MEM_COMMIT,  PAGE_READWRITE));
+  #else
+    populated  =  FastMemPoolProvision::Prefault  ==  provision;
+  #if defined(DEF_NUMA)
+    // the pages must be placed after mbind:
+    populated  =  populated  &&  numa_hw_nodes  <  2;
+  #endif
+    const int  populate  =  populated  ?  MAP_POPULATE  :  MAP_NORESERVE;
+    void  *range  =  mmap(nullptr,  Leaf_Map_Bytes,  PROT_READ | PROT_WRITE,  MAP_PRIVATE | MAP_ANONYMOUS | populate,  -1,  0);
+    leaf_map  =  MAP_FAILED  ==  range  ?  nullptr  :  static_cast<char *>(range);
+  #endif
+    if (leaf_map)
+    {
+      leaf_base  =  reinterpret_cast<char *>((reinterpret_cast<uintptr_t>(leaf_map)  +  Leaf_Base_Align  -  1)
+                                          &  ~static_cast<uintptr_t>(Leaf_Base_Align  -  1));
+    }
+    for (int   i  =  0;  i  < Leaf_Cnt ;  ++i)
+    {
+      if (leaf_base  &&  !lazy)
+      {
+        leaf_buf[i] = leaf_base  +  static_cast<std::size_t>(i)  *  Leaf_Size_Bytes;
+        leaf_array[i].state.store(leaf_state(Leaf_Size_Bytes,  0),  std::memory_order_relaxed);
+      }  else  {  // everything goes to OS malloc (or the leaf waits for provision_leaf())
+        leaf_buf[i] = leaf_base  ?  leaf_base  +  static_cast<std::size_t>(i)  *  Leaf_Size_Bytes  :  nullptr;
+        leaf_array[i].state.store(leaf_state(0,  Leaf_Size_Bytes),  std::memory_order_relaxed);
+      }
+    }
+#else
     void  *buf_array[Leaf_Cnt];
     for (int   i  =  0;  i  < Leaf_Cnt ;  ++i)
     {
-      buf_array[i]  =  malloc(Leaf_Size_Bytes);
+      buf_array[i]  =  lazy  ?  nullptr  :  malloc(Leaf_Size_Bytes);
     }
     std::sort(std::begin(buf_array), std::end(buf_array), [](const void * lh, const void * rh) { return (uint64_t)(lh) < (uint64_t)(rh); });
     uint64_t last = 0;
@@ -314,17 +962,42 @@ public:
     {
       if (buf_array[i])
       {
-        leaf_array[i].buf = static_cast<char *>(buf_array[i]);
-        leaf_array[i].available.store(Leaf_Size_Bytes,  std::memory_order_relaxed);
-        leaf_array[i].deallocated.store(0,  std::memory_order_relaxed);
+        leaf_buf[i] = static_cast<char *>(buf_array[i]);
+        leaf_array[i].state.store(leaf_state(Leaf_Size_Bytes,  0),  std::memory_order_relaxed);
       }  else  {
-        leaf_array[i].buf = nullptr;
-        leaf_array[i].available.store(0,  std::memory_order_relaxed);
-        leaf_array[i].deallocated.store(Leaf_Size_Bytes,  std::memory_order_relaxed);
+        leaf_buf[i] = nullptr;
+        leaf_array[i].state.store(leaf_state(0,  Leaf_Size_Bytes),  std::memory_order_relaxed);
       }
     }
-    std::atomic_thread_fence(std::memory_order_release);
-    return;
+#endif
+    lazy_next.store(lazy  ?  0  :  Leaf_Cnt,  std::memory_order_relaxed);
+#if defined(DEF_NUMA)
+    for (int   i  =  0;  i  < Leaf_Cnt ;  ++i)
+    {
+      numa_bind_leaf(i);
+    }
+#endif
+    if (FastMemPoolProvision::Prefault  ==  provision  &&  !populated)
+    {
+      for (int   i  =  0;  i  < Leaf_Cnt ;  ++i)
+      {
+        prefault_leaf(leaf_buf[i]);
+      }
+    }  else if (FastMemPoolProvision::Pretouch  ==  provision)
+    {
+      pretouch_leaves(pretouch_threads);
+    }
+#if defined(DEF_Pool_registry)
+    registry_id  =  fast_mem_pool_registry.add_owner(this,  &registry_free,  &registry_owns,  &registry_free_os);
+  #if defined(DEF_Leaf_mmap)
+    fast_mem_pool_registry.add_range(registry_id,  leaf_base,  leaf_base  ?  Leaf_Range_Bytes  :  0);
+  #else
+    for (int   i  =  0;  i  < Leaf_Cnt ;  ++i)
+    {
+      fast_mem_pool_registry.add_range(registry_id,  leaf_buf[i],  Leaf_Size_Bytes);
+    }
+  #endif
+#endif
   }  // FastMemPool
 
   /**
@@ -340,10 +1013,32 @@ public:
 
   ~FastMemPool()
   {
+#if defined(DEF_Pool_registry)
+  #if defined(DEF_Leaf_mmap)
+    fast_mem_pool_registry.remove_owner(registry_id,  leaf_base,  leaf_base  ?  Leaf_Range_Bytes  :  0);
+  #else
+    for (int   i  =  0;  i  < Leaf_Cnt ;  ++i)
+    {
+      fast_mem_pool_registry.remove_owner(registry_id,  leaf_buf[i],  Leaf_Size_Bytes);
+    }
+  #endif
+    fast_mem_pool_registry.release_owner(registry_id);
+#endif
+#if defined(DEF_Leaf_mmap)
+    if (leaf_map)
+    {
+  #if defined(_WIN32)
+      VirtualFree(leaf_map,  0,  MEM_RELEASE);
+  #else
+      munmap(leaf_map,  Leaf_Map_Bytes);
+  #endif
+    }
+#else
     for (int   i  =  0;  i  < Leaf_Cnt ;  ++i)
     {
-      if (leaf_array[i].buf)  free(leaf_array[i].buf);
+      if (leaf_buf[i])  free(leaf_buf[i]);
     }
+#endif
 #if defined(DEF_Auto_deallocate)
     #if defined(Debug)
     {
@@ -369,12 +1064,611 @@ public:
     return;
   }
 
+  /**
+   * @brief owns
+   * @param ptr  -  any address
+   * @return - true if ptr lies in the leaves of this pool (under DEF_Leaf_mmap only a range compare)
+   */
+  bool  owns(const void  *ptr)  const
+  {
+#if defined(DEF_Leaf_mmap)
+    return  own_leaf_id(ptr)  >=  0;
+#else
+    const char  *p  =  static_cast<const char  *>(ptr);
+    for (int   i  =  0;  i  < Leaf_Cnt ;  ++i)
+    {
+      const char  *buf  =  leaf_buf[i];
+      if (buf  &&  buf  <=  p  &&  p  <  buf  +  Leaf_Size_Bytes)  {  return  true;  }
+    }
+    return  false;
+#endif
+  }
+
+  /**
+   * @brief alloc_size
+   * @param ptr  -  allocation of this pool (leaves or OS malloc fallback)
+   * @return - the size given to fmalloc
+   */
+  std::size_t  alloc_size(const void  *ptr)  const
+  {
+#if defined(DEF_Headerless_small)
+    if (Headerless_small  &&  is_small(ptr))
+    {
+      const int  size  =  small_live_size(ptr);
+      return  size  >  0  ?  size  :  0;
+    }
+#endif
+    const AllocHeader  *head  =  reinterpret_cast<const AllocHeader  *>(static_cast<const char  *>(ptr)  -  sizeof(AllocHeader));
+    return  head->size  >  0  ?  head->size  :  0;
+  }
+
+  // bytes in front of each allocation (headerless small allocations have none):
+  static constexpr std::size_t  get_header_size()
+  {
+    return  sizeof(AllocHeader);
+  }
+
+  // true: fmalloc and fmalloc_aligned go to OS malloc when the leaves are full, ffree frees it:
+  static constexpr bool  get_do_os_malloc()
+  {
+    return  Do_OS_malloc;
+  }
+
+  /**
+   * @brief release_cpu_slots - return the chunks held by the per-CPU slots (DEF_Rseq_slots) to the leaves
+   * The calling thread visits each CPU (sched_setaffinity), the slot of a CPU is changed only there.
+   * Maintenance call: after it, when every allocation is returned, get_free_leaves() is Leaf_Cnt again.
+   */
+  void  release_cpu_slots()
+  {
+#if defined(DEF_Rseq_slots) && defined(FMP_RSEQ)
+    if (!rseq_ready())  {  return;  }
+    cpu_set_t  saved;
+    if (sched_getaffinity(0,  sizeof(saved),  &saved))  {  return;  }
+    for (int  cpu  =  0;  cpu  <  DEF_Rseq_Max_Cpus  &&  cpu  <  CPU_SETSIZE;  ++cpu)
+    {
+      uintptr_t  *slot  =  &cpu_slot[cpu].cur;
+      if (0  ==  *static_cast<volatile uintptr_t  *>(slot))  {  continue;  }
+      cpu_set_t  one;
+      CPU_ZERO(&one);
+      CPU_SET(cpu,  &one);
+      if (sched_setaffinity(0,  sizeof(one),  &one))  {  continue;  }
+      for (int  attempt  =  0;  attempt  <  100;  ++attempt)
+      {
+        const uintptr_t  cur  =  *static_cast<volatile uintptr_t  *>(slot);
+        if (0  ==  cur)  {  break;  }
+        if (0  ==  rseq_cmp_store(slot,  cur,  0,  cpu))
+        {
+          retire_chunk(cur);
+          break;
+        }
+      }
+    }
+    sched_setaffinity(0,  sizeof(saved),  &saved);
+#endif
+  }
+
+  /**
+   * @brief release_all - arena reset: every leaf is available again in O(Leaf_Cnt), without ffree of each allocation
+   * Maintenance call: nothing allocated from the leaves is used any more and no thread allocates meanwhile,
+   * the OS malloc fallbacks are not touched (they still need ffree), nor are the heap profile records.
+   */
+  void  release_all()
+  {
+    release_cpu_slots();
+    for (int   i  =  0;  i  < Leaf_Cnt ;  ++i)
+    {
+      // (a leaf that is not provisioned yet stays as it is)
+      if (leaf_buf[i]
+          &&  leaf_state(0,  Leaf_Size_Bytes)  !=  leaf_array[i].state.load(std::memory_order_relaxed))
+      {
+        leaf_array[i].state.store(leaf_state(Leaf_Size_Bytes,  0),  std::memory_order_release);
+      }
+      leaf_epoch[i].store(0,  std::memory_order_relaxed);
+#if defined(DEF_Alloc_site)
+      private_cursor[i].store(0,  std::memory_order_relaxed);
+#endif
+    }
+    for (auto  &&slot  :  epoch_slots)
+    {
+      slot.cursor.store(0,  std::memory_order_relaxed);
+      slot.key.store(0,  std::memory_order_release);
+    }
+#if defined(DEF_Buddy_medium)
+    // the buddy leaves were reset with the others:
+    for (auto  &&it  :  leaf_buddy)  {  it.store(false,  std::memory_order_relaxed);  }
+    for (auto  &&it  :  buddy_free)  {  it  =  nullptr;  }
+    memset(buddy_tag,  0,  sizeof(buddy_tag));
+#endif
+#if defined(DEF_Headerless_small)
+    if (Headerless_small)
+    {
+      const int  claimed  =  std::min(small_claimed.load(std::memory_order_acquire),  Small_Leaf_Cnt);
+      for (int  i  =  0;  i  <  claimed;  ++i)
+      {
+        memset(static_cast<void  *>(small_bitmap(small_leaf(i))),  0,  Small_Bitmap_Words  *  sizeof(uint64_t));
+      }
+      for (auto  &&it  :  small_cur)  {  it.store(0,  std::memory_order_relaxed);  }
+      small_claimed.store(0,  std::memory_order_release);
+    }
+#endif
+#if defined(Debug)
+    {
+      std::lock_guard<std::mutex>  lg(mut_map_alloc_info);
+      for (auto  it  =  map_alloc_info.begin();  it  !=  map_alloc_info.end();)
+      {
+        it  =  owns(it->first)  ?  map_alloc_info.erase(it)  :  std::next(it);
+      }
+    }
+#endif
+  }  // release_all
+
+  /**
+   * ScopedArena
+   * Private leaves of one thread for the life of a scope (a request): fmalloc bumps the leaves
+   * it claimed from the pool (fully available ones, they look depleted to the other threads)
+   * without atomics, the destructor gives them back reset: the teardown is one store per leaf.
+   * ffree of an arena allocation is allowed, the leaf is reset only by the arena.
+   * Allocations that do not fit a leaf or come after Arena_Max_Leaves go to the pool fmalloc
+   * and are freed by the destructor too.
+   * mark()/rollback(mark) free everything allocated after the mark (a stack of up to
+   * Arena_Max_Marks marks: backtracking parsers, exception unwind): each leaf claimed after the mark
+   * goes back with one store, the cut of the kept leaf after the mark is walked header by header, so the
+   * cost grows with what is rolled back. The allocations after the mark must not be freed after
+   * the rollback, in the kept leaf their tags are cleared (ffree rejects them).
+
+   FastMemPool<>::ScopedArena  arena(&pool);
+   Request  *req  =  new (arena.fmalloc(sizeof(Request))) Request();
+   */
+  class ScopedArena
+  {
+  public:
+    static constexpr int  Arena_Max_Leaves  {  16  };
+    static constexpr int  Arena_Max_Marks  {  64  };
+
+    // checkpoint of mark(), valid until a rollback to an older mark or release()
+    // (a rollback to it keeps it, the parser can backtrack to the same place again):
+    struct Mark {
+      const ScopedArena  *arena  {  nullptr  };
+      int  depth  {  -1  };
+      uint64_t  serial  {  0  };
+    };
+
+    explicit ScopedArena(FastMemPool  *in_pool)  noexcept  :  pool(in_pool)  {  }
+    ScopedArena(const ScopedArena  &)  =  delete;
+    ScopedArena  & operator=(const ScopedArena  &)  =  delete;
+
+    ~ScopedArena()
+    {
+      release();
+    }
+
+    /**
+     * @brief fmalloc
+     * @param allocation_size  -  volume to allocate
+     * @return - allocation ptr (nullptr as the pool fmalloc)
+     */
+    void  * fmalloc(std::size_t  allocation_size)
+    {
+      const int  real_size  =  allocation_size  <  static_cast<std::size_t>(Leaf_Size_Bytes)
+        ?  static_cast<int>(allocation_size  +  sizeof(AllocHeader))  :  Leaf_Size_Bytes;
+      // one byte of the leaf is never given: the ffree'd bytes can not reach a reset of the leaf
+      if (leaf_cnt  >  0  &&  available  >  real_size)
+      {
+        return  cut(real_size);
+      }
+      if (real_size  <  Leaf_Size_Bytes  &&  leaf_cnt  <  Arena_Max_Leaves  &&  claim_leaf())
+      {
+        return  cut(real_size);
+      }
+      void  *re  =  pool->fmalloc(allocation_size);
+      if (re)  {  overflow.push_back(re);  }
+      return  re;
+    }
+
+    // everything allocated by the arena is freed, the arena can be used again (the marks are stale):
+    void  release()
+    {
+      release_leaves(0);
+      available  =  0;
+      release_overflow(0);
+      mark_depth  =  0;
+    }
+
+    /**
+     * @brief mark - checkpoint of the arena
+     * @return - mark for rollback(), an invalid mark if Arena_Max_Marks are taken
+     * (range_error if Raise_Exeptions)
+     */
+    Mark  mark()
+    {
+      if (mark_depth  >=  Arena_Max_Marks)
+      {
+        if constexpr (Raise_Exeptions)
+        {
+          throw std::range_error("FastMemPool::ScopedArena::mark: too many marks");
+        }
+        return  Mark();
+      }
+      MarkPlace  &place  =  marks[mark_depth];
+      place.serial  =  ++mark_serial;
+      place.leaf_cnt  =  leaf_cnt;
+      place.available  =  available;
+      place.overflow_cnt  =  overflow.size();
+      Mark  re;
+      re.arena  =  this;
+      re.depth  =  mark_depth++;
+      re.serial  =  place.serial;
+      return  re;
+    }
+
+    /**
+     * @brief rollback - free everything allocated after the mark, the mark stays valid, the later marks become stale
+     * @param checkpoint  -  mark() of this arena
+     * @return - false if the mark is of the other arena or stale (range_error if Raise_Exeptions)
+     */
+    bool  rollback(const Mark  &checkpoint)
+    {
+      if (checkpoint.arena  !=  this  ||  checkpoint.depth  <  0  ||  checkpoint.depth  >=  mark_depth
+          ||  marks[checkpoint.depth].serial  !=  checkpoint.serial)
+      {
+        if constexpr (Raise_Exeptions)
+        {
+          throw std::range_error("FastMemPool::ScopedArena::rollback: the mark is stale or not of this arena");
+        }
+        return  false;
+      }
+      const MarkPlace  &place  =  marks[checkpoint.depth];
+      if (place.leaf_cnt  >  0)
+      {
+        const int  cursor  =  place.leaf_cnt  <  leaf_cnt  ?  passed_available[place.leaf_cnt  -  1]  :  available;
+        forget_cut(leaf_ids[place.leaf_cnt  -  1],  cursor,  place.available);
+      }
+      // the leaves claimed after the mark go back to the pool:
+      release_leaves(place.leaf_cnt);
+      available  =  place.available;
+      if (leaf_cnt  >  0)  {  publish_cursor(leaf_ids[leaf_cnt  -  1],  available  +  1);  }
+      release_overflow(place.overflow_cnt);
+      mark_depth  =  checkpoint.depth  +  1;
+      return  true;
+    }
+
+    // leaves owned by the arena now:
+    int  get_leaves()  const  noexcept  {  return  leaf_cnt;  }
+
+  private:
+    struct MarkPlace {
+      uint64_t  serial;
+      int  leaf_cnt;
+      int  available;
+      std::size_t  overflow_cnt;
+    };
+
+    /**
+     * @brief forget_cut - the allocations in [cursor, end) of the leaf are taken back: the live ones lose
+     * their tags, the bytes of the freed ones leave the leaf account (ffree of the older allocations may run meanwhile)
+     * @param leaf_id  -  kept leaf of the arena
+     * @param cursor  -  available of the leaf now
+     * @param end  -  available of the leaf at the mark
+     */
+    void  forget_cut(int  leaf_id,  int  cursor,  int  end)
+    {
+      char  *buf  =  pool->leaf_buf[leaf_id];
+      int  freed  =  0;
+      while (cursor  <  end)
+      {
+        AllocHeader  *head  =  reinterpret_cast<AllocHeader  *>(buf  +  cursor);
+        if (head->size  <  0  ||  head->size  >=  Leaf_Size_Bytes)  {  break;  }
+        if (leaf_id  ==  head->leaf_id  &&  ((uint64_t)pool)  +  leaf_id  ==  head->tag_this)
+        {
+          head->tag_this  =  0;
+          head->leaf_id  =  0;
+        }  else  {
+          freed  +=  head->size  +  static_cast<int>(sizeof(AllocHeader));
+        }
+        cursor  +=  head->size  +  static_cast<int>(sizeof(AllocHeader));
+      }
+      if (freed)  {  pool->leaf_array[leaf_id].state.fetch_sub(freed,  std::memory_order_acq_rel);  }
+    }
+
+    void  release_leaves(int  keep_cnt)
+    {
+      for (int  i  =  keep_cnt;  i  <  leaf_cnt;  ++i)
+      {
+        publish_cursor(leaf_ids[i],  0);
+        pool->leaf_array[leaf_ids[i]].state.store(leaf_state(Leaf_Size_Bytes,  0),  std::memory_order_release);
+      }
+      leaf_cnt  =  keep_cnt;
+    }
+
+    void  release_overflow(std::size_t  keep_cnt)
+    {
+      for (std::size_t  i  =  keep_cnt;  i  <  overflow.size();  ++i)  {  pool->ffree(overflow[i]);  }
+      overflow.resize(keep_cnt);
+    }
+
+    char  * cut(int  real_size)
+    {
+      const int  leaf_id  =  leaf_ids[leaf_cnt  -  1];
+      available  -=  real_size;
+      char  *re  =  pool->put_header(pool->leaf_buf[leaf_id]  +  available,  leaf_id,  real_size);
+      publish_cursor(leaf_id,  available  +  1);
+      return  re;
+    }
+
+    bool  claim_leaf()
+    {
+      const int  leaf_id  =  pool->claim_free_leaf();
+      if (leaf_id  <  0)  {  return  false;  }
+      if (leaf_cnt  >  0)  {  passed_available[leaf_cnt  -  1]  =  available;  }
+      leaf_ids[leaf_cnt++]  =  leaf_id;
+      available  =  Leaf_Size_Bytes;
+      publish_cursor(leaf_id,  available  +  1);
+      return  true;
+    }
+
+    // (DEF_Alloc_site) cursor + 1 of the arena leaf for dump_live_by_site(), 0 - the leaf is back in the pool:
+    void  publish_cursor(int  leaf_id,  int  cursor)
+    {
+#if defined(DEF_Alloc_site)
+      pool->private_cursor[leaf_id].store(cursor,  std::memory_order_release);
+#else
+      (void)leaf_id;
+      (void)cursor;
+#endif
+    }
+
+    FastMemPool  *pool;
+    int  leaf_ids[Arena_Max_Leaves];
+    int  leaf_cnt  {  0  };
+    // free bytes of the last claimed leaf, cut from the top as the pool does:
+    int  available  {  0  };
+    // the free bytes left in each leaf when the next one was claimed:
+    int  passed_available[Arena_Max_Leaves];
+    std::vector<void  *>  overflow;
+    MarkPlace  marks[Arena_Max_Marks];
+    int  mark_depth  {  0  };
+    uint64_t  mark_serial  {  0  };
+  };
+
+  /**
+   * @brief fmalloc_epoch
+   * Allocation in the leaves of the epoch: they are claimed fully available from the pool and hold
+   * only this epoch (the other epochs and the cur_leaf rotation do not see them), free_epoch()
+   * recycles them all at once. ffree of an epoch allocation is allowed, the leaf is reset only by free_epoch.
+   * (Debug: the allocations are not tracked by fmallocd, use ffree, not FFREE)
+   * @param allocation_size  -  volume to allocate, must fit a leaf
+   * @param epoch  -  epoch id (any but UINT64_MAX), up to DEF_Epoch_Slots epochs at the same time
+   * @return - allocation ptr or nullptr (range_error if Raise_Exeptions) if the allocation does not fit a leaf,
+   * no leaf is fully available or every epoch slot is taken
+   */
+  void  * fmalloc_epoch(std::size_t  allocation_size,  uint64_t  epoch)
+  {
+    EpochSlot  *slot  =  allocation_size  +  sizeof(AllocHeader)  <  static_cast<std::size_t>(Leaf_Size_Bytes)  ?  epoch_slot(epoch,  true)  :  nullptr;
+    if (slot)
+    {
+      const int  real_size  =  static_cast<int>(allocation_size  +  sizeof(AllocHeader));
+      const int  slot_tag  =  static_cast<int>(slot  -  epoch_slots)  +  1;
+      uint64_t  cursor  =  slot->cursor.load(std::memory_order_acquire);
+      for (;;)
+      {
+        const int  leaf_id  =  static_cast<int>(cursor  >>  32)  -  1;
+        const int  available  =  static_cast<int>(static_cast<uint32_t>(cursor));
+        // one byte of the leaf is never given: the ffree'd bytes can not reach a reset of the leaf
+        if (leaf_id  >=  0  &&  available  >  real_size)
+        {
+          if (slot->cursor.compare_exchange_weak(cursor,  epoch_cursor(leaf_id,  available  -  real_size),
+                std::memory_order_acq_rel,  std::memory_order_acquire))
+          {
+            return  put_header(leaf_buf[leaf_id]  +  available  -  real_size,  leaf_id,  real_size);
+          }
+          continue;
+        }
+        // the current leaf of the epoch is over:
+        const int  new_leaf  =  claim_free_leaf();
+        if (new_leaf  <  0)  {  break;  }
+        leaf_epoch[new_leaf].store(slot_tag,  std::memory_order_release);
+        if (slot->cursor.compare_exchange_strong(cursor,  epoch_cursor(new_leaf,  Leaf_Size_Bytes  -  real_size),
+              std::memory_order_acq_rel,  std::memory_order_acquire))
+        {
+#if defined(DEF_Alloc_site)
+          // the passed leaf keeps its last cursor for dump_live_by_site():
+          if (leaf_id  >=  0)  {  private_cursor[leaf_id].store(available  +  1,  std::memory_order_release);  }
+#endif
+          return  put_header(leaf_buf[new_leaf]  +  Leaf_Size_Bytes  -  real_size,  new_leaf,  real_size);
+        }
+        // the other thread gave the epoch a leaf meanwhile, this one goes back:
+        leaf_epoch[new_leaf].store(0,  std::memory_order_relaxed);
+        leaf_array[new_leaf].state.store(leaf_state(Leaf_Size_Bytes,  0),  std::memory_order_release);
+      }
+    }
+    if constexpr (Raise_Exeptions)
+    {
+      throw std::range_error("FastMemPool::fmalloc_epoch: no leaf or slot for the epoch");
+    }
+    return  nullptr;
+  }  // fmalloc_epoch
+
+  /**
+   * @brief free_epoch - every leaf of the epoch is available again in O(Leaf_Cnt), the slot is free
+   * Nothing allocated in the epoch is used any more and no thread allocates in it meanwhile.
+   * @param epoch  -  epoch id of fmalloc_epoch
+   * @return - false if the epoch has no allocations
+   */
+  bool  free_epoch(uint64_t  epoch)
+  {
+    EpochSlot  *slot  =  epoch_slot(epoch,  false);
+    if (!slot)  {  return  false;  }
+    const int  slot_tag  =  static_cast<int>(slot  -  epoch_slots)  +  1;
+    slot->cursor.store(0,  std::memory_order_release);
+    for (int  i  =  0;  i  <  Leaf_Cnt;  ++i)
+    {
+      int  expected  =  slot_tag;
+      // (the tag goes first: a reset leaf may be claimed by the other epoch at once)
+      if (leaf_epoch[i].compare_exchange_strong(expected,  0,  std::memory_order_acq_rel))
+      {
+#if defined(DEF_Alloc_site)
+        private_cursor[i].store(0,  std::memory_order_relaxed);
+#endif
+        leaf_array[i].state.store(leaf_state(Leaf_Size_Bytes,  0),  std::memory_order_release);
+      }
+    }
+    slot->key.store(0,  std::memory_order_release);
+    return  true;
+  }  // free_epoch
+
+  // true if fmalloc goes through the per-CPU slots (DEF_Rseq_slots, the pool fits and the thread has rseq):
+  bool  get_cpu_slots()  const
+  {
+#if defined(DEF_Rseq_slots) && defined(FMP_RSEQ)
+    return  Rseq_slots  &&  rseq_ready();
+#else
+    return  false;
+#endif
+  }
+
+#if defined(DEF_Headerless_small)
+  /**
+   * @brief get_small_live - headerless small objects alive now (popcount of the live bitmaps)
+   * @param size_class_bytes  -  only the size class of these bytes, 0 - all classes
+   */
+  int64_t  get_small_live(std::size_t  size_class_bytes  =  0)  const
+  {
+    int64_t  re  =  0;
+    if (!Headerless_small  ||  size_class_bytes  >  Small_Max_Bytes)  {  return  re;  }
+    const int  claimed  =  std::min(small_claimed.load(std::memory_order_acquire),  Small_Leaf_Cnt);
+    for (int  i  =  0;  i  <  claimed;  ++i)
+    {
+      SmallLeaf  *leaf  =  small_leaf(i);
+      const int  class_tag  =  leaf->class_tag.load(std::memory_order_acquire);
+      if (!class_tag  ||  (size_class_bytes  &&  class_tag  !=  small_class(size_class_bytes)  +  1))  {  continue;  }
+      const std::atomic<uint64_t>  *bitmap  =  small_bitmap(leaf);
+      for (int  w  =  0;  w  <  Small_Bitmap_Words;  ++w)  {  re  +=  small_popcount(bitmap[w].load(std::memory_order_relaxed));  }
+    }
+    return  re;
+  }
+#endif
+#if defined(DEF_Buddy_medium)
+  // leaves split into buddy blocks now (a leaf goes back to the pool when its blocks coalesce whole):
+  int  get_buddy_leaves()  const
+  {
+    int  re  =  0;
+    for (auto  &&it  :  leaf_buddy)  {  re  +=  it.load(std::memory_order_acquire)  ?  1  :  0;  }
+    return  re;
+  }
+#endif
+
+  /**
+   * @brief get_free_leaves
+   * @return - count of leaves that are fully available (nothing allocated from them),
+   * when every allocation is returned it must be Leaf_Cnt, otherwise leaves are lost to the pool
+   */
+  int  get_free_leaves()  const
+  {
+    int  re  =  0;
+    for (int   i  =  0;  i  < Leaf_Cnt ;  ++i)
+    {
+      if (leaf_buf[i]
+          &&  Leaf_Size_Bytes  ==  state_available(leaf_array[i].state.load(std::memory_order_acquire)))
+      {
+        ++re;
+      }
+    }
+    return  re;
+  }
+
+#if defined(DEF_NUMA)
+  // leaf groups, 1 on a single node machine (unless DEF_NUMA_Nodes emulates more):
+  int  get_numa_nodes()  const
+  {
+    return  numa_nodes;
+  }
+
+  /**
+   * @brief numa_stats
+   * @return - leaves, free leaves, available bytes and the fallback counters of each leaf group
+   */
+  std::vector<FastMemPoolNodeStat>  numa_stats()  const
+  {
+    std::vector<FastMemPoolNodeStat>  re;
+    for (int  n  =  0;  n  <  numa_nodes;  ++n)
+    {
+      const NumaNode  &group  =  numa_node[n];
+      FastMemPoolNodeStat  stat  {  n,  group.leaf_cnt,  0,  0,
+        group.remote_allocs.load(std::memory_order_relaxed),  group.os_allocs.load(std::memory_order_relaxed)  };
+      for (int  i  =  group.first_leaf;  i  <  group.first_leaf  +  group.leaf_cnt;  ++i)
+      {
+        if (!leaf_buf[i])  {  continue;  }
+        const int  available  =  state_available(leaf_array[i].state.load(std::memory_order_acquire));
+        stat.available_bytes  +=  available;
+        if (Leaf_Size_Bytes  ==  available)  {  ++stat.free_leaves;  }
+      }
+      re.push_back(stat);
+    }
+    return  re;
+  }
+#endif
+
   FastMemPool &operator=(const FastMemPool &) = delete;
   FastMemPool (const FastMemPool &) = delete;
 
   FastMemPool &operator=(FastMemPool &&) = delete;
   FastMemPool (FastMemPool &&) = delete;
 
+#if defined(DEF_Contention_profile)
+  /**
+   * @brief contention_report
+   * Contention heatmap: for each leaf the histogram of the scan length of fmalloc
+   * that started from this leaf (how many leaves were skipped, "OS" == all leaves were skipped),
+   * retries of the reservation CAS (another thread won the race for the leaf),
+   * failed leaf reset CAS in ffree and cur_leaf stores made when the leaf was depleted.
+   * Each cell is shaded relative to the hottest cell of its column.
+   * @return - text report
+   */
+  std::string  contention_report()  const
+  {
+    static const char  *columns[Contention_Columns]  =  {
+      "0", "1", "2-3", "4-7", "8-15", "16+", "OS", "cas_retry", "reset_cas", "cur_leaf" };
+    static const char  shades[]  =  " .:-=+*#%@";
+    uint64_t  cells[Leaf_Cnt][Contention_Columns];
+    uint64_t  col_max[Contention_Columns]  =  {};
+    for (int  i  =  0;  i  <  Leaf_Cnt;  ++i)
+    {
+      for (int  h  =  0;  h  <  Contention_Scan_Buckets;  ++h)
+      {
+        cells[i][h]  =  contention[i].scans[h].load(std::memory_order_relaxed);
+      }
+      cells[i][Contention_Scan_Buckets]  =  contention[i].reserve_retries.load(std::memory_order_relaxed);
+      cells[i][Contention_Scan_Buckets  +  1]  =  contention[i].reset_cas_fails.load(std::memory_order_relaxed);
+      cells[i][Contention_Scan_Buckets  +  2]  =  contention[i].cur_leaf_stores.load(std::memory_order_relaxed);
+      for (int  c  =  0;  c  <  Contention_Columns;  ++c)
+      {
+        col_max[c]  =  std::max(col_max[c],  cells[i][c]);
+      }
+    }
+
+    std::ostringstream  out;
+    out  <<  "FastMemPool contention: scan length histogram | reservation CAS retries | reset_cas fails | cur_leaf stores\n";
+    out  <<  "leaf ";
+    for (int  c  =  0;  c  <  Contention_Columns;  ++c)
+    {
+      out  <<  std::setw(11)  <<  columns[c];
+    }
+    out  <<  "\n";
+    for (int  i  =  0;  i  <  Leaf_Cnt;  ++i)
+    {
+      out  <<  std::setw(4)  <<  i  <<  " ";
+      for (int  c  =  0;  c  <  Contention_Columns;  ++c)
+      {
+        const int  shade  =  col_max[c]  ?  static_cast<int>((cells[i][c]  *  9  +  col_max[c]  -  1)  /  col_max[c])  :  0;
+        out  <<  std::setw(10)  <<  cells[i][c]  <<  shades[shade];
+      }
+      out  <<  "\n";
+    }
+    return  out.str();
+  }  // contention_report
+#endif
+
 #if defined(Debug)
   /**
    * @brief fmallocd
@@ -383,11 +1677,13 @@ public:
    * @param line
    * @param function_name
    * @param allocation_size
+   * @param hint  -  lifetime group (see fmalloc(size, hint))
    * @return
    */
-  void  * fmallocd(const char *filename, unsigned int line, const char *function_name,  std::size_t  allocation_size)
+  void  * fmallocd(const char *filename, unsigned int line, const char *function_name,  std::size_t  allocation_size,
+                   LifetimeHint  hint  =  LifetimeHint::Medium)
   {
-    void  *re  =  fmalloc(allocation_size);
+    void  *re  =  fmalloc(allocation_size,  hint);
     if (re)
     {
       std::lock_guard<std::mutex>  lg(mut_map_alloc_info);
@@ -471,13 +1767,34 @@ public:
 #endif
 private:
 
-  struct Leaf
+  /*
+    Leaf state is packed into one 64 bit atomic, so the fmalloc reservation and the ffree reset
+    see "available" and "deallocated" in the same snapshot:
+    high 32 bits - available == offset, low 32 bits - deallocated (control of deallocations).
+    ffree adds to deallocated with fetch_add, it never carries into available (deallocated <= Leaf_Size_Bytes).
+  */
+  static constexpr uint64_t  leaf_state(int  available,  int  deallocated)
+  {
+    return  (static_cast<uint64_t>(static_cast<uint32_t>(available))  <<  32)  |  static_cast<uint32_t>(deallocated);
+  }
+  static constexpr int  state_available(uint64_t  state)
+  {
+    return  static_cast<int>(static_cast<uint32_t>(state  >>  32));
+  }
+  static constexpr int  state_deallocated(uint64_t  state)
+  {
+    return  static_cast<int>(static_cast<uint32_t>(state));
+  }
+
+#if defined(DEF_Cache_line_isolation)
+  // each Leaf state and cur_leaf get their own cache line:
+  static constexpr std::size_t  Leaf_Align  {  DEF_Cache_line_Bytes  };
+#else
+  static constexpr std::size_t  Leaf_Align  {  alignof(std::atomic<uint64_t>)  };
+#endif
+  struct alignas(Leaf_Align) Leaf
   {
-      char  *buf;
-      // available == offset
-      std::atomic<int>  available  {  Leaf_Size_Bytes  };
-      // control of deallocations:
-      std::atomic<int>  deallocated  {  0  };
+      std::atomic<uint64_t>  state  {  leaf_state(Leaf_Size_Bytes,  0)  };
   };
 
   /*
@@ -491,8 +1808,10 @@ private:
     size - allocation size, if 0 <= size> = LeafSizeBytes - it means someone else's allocation.
      The header can be obtained at any time by a negative offset relative to the *pointer.
 */
-  const int  OS_malloc_id  {  -2020071708  };
-  const int  TAG_OS_malloc  {  1020071708  };
+  static constexpr int  OS_malloc_id  {  -2020071708  };
+  // OS malloc of fmalloc_aligned: the malloc pointer is in the word in front of the header
+  static constexpr int  OS_aligned_id  {  -2020071709  };
+  static constexpr int  TAG_OS_malloc  {  1020071708  };
   struct AllocHeader {
     /*
      label of own allocations:
@@ -500,14 +1819,1252 @@ private:
     uint64_t  tag_this  {  2020071700  };
     // allocation size (without sizeof(AllocHeader)):
     int  size;
-    // allocation place id (Leaf ID  or OS_malloc_id):
+    // allocation place id (Leaf ID  or OS_malloc_id, OS_aligned_id):
     int  leaf_id  {  -2020071708  };
+#if defined(DEF_Alloc_site)
+    // opt-in extra word: FastMemPoolSites id of the allocation place:
+    int  site_id  {  0  };
+    // (the header stays a multiple of 16 bytes: the cuts of sizes rounded to 16 keep the allocations aligned)
+    int  site_pad[3];
+#endif
   };
 
-  // Memory pool:
-  Leaf  leaf_array[Leaf_Cnt];
-  std::atomic<int>  cur_leaf  {  0  };
-
+  static bool  os_header(const AllocHeader  *head)
+  {
+    return  TAG_OS_malloc  ==  head->tag_this  &&  head->size  >  0
+        &&  (OS_malloc_id  ==  head->leaf_id  ||  OS_aligned_id  ==  head->leaf_id);
+  }
+
+  // the pointer malloc gave for the OS allocation of the header:
+  static void  * os_block(AllocHeader  *head)
+  {
+    if (OS_aligned_id  !=  head->leaf_id)  {  return  head;  }
+    void  *block;
+    memcpy(&block,  reinterpret_cast<char  *>(head)  -  sizeof(void  *),  sizeof(block));
+    return  block;
+  }
+
+  /**
+   * @brief os_malloc_aligned - OS malloc fallback of fmalloc_aligned: the header is in front of the
+   * aligned allocation (leaf_id == OS_aligned_id), the malloc pointer in front of the header
+   * @param allocation_size  -  volume to allocate
+   * @param alignment  -  power of 2
+   * @return - allocation ptr or nullptr
+   */
+  char  * os_malloc_aligned(std::size_t  allocation_size,  std::size_t  alignment)
+  {
+    const std::size_t  front  =  sizeof(void  *)  +  sizeof(AllocHeader)  +  alignment  -  1;
+    char  *block  =  static_cast<char  *>(malloc(allocation_size  +  front));
+    if (!block)  {  return  nullptr;  }
+    char  *re  =  reinterpret_cast<char  *>((reinterpret_cast<uintptr_t>(block)  +  front)  &  ~static_cast<uintptr_t>(alignment  -  1));
+    AllocHeader  *head  =  reinterpret_cast<AllocHeader  *>(re  -  sizeof(AllocHeader));
+    memcpy(reinterpret_cast<char  *>(head)  -  sizeof(void  *),  &block,  sizeof(block));
+    head->leaf_id  =  OS_aligned_id;
+    head->tag_this  =  TAG_OS_malloc;
+    head->size  =  static_cast<int>(allocation_size);
+#if defined(DEF_Alloc_site)
+    head->site_id  =  0;
+#endif
+#if defined(DEF_Auto_deallocate)
+  #if not defined(Debug)
+    {
+      std::lock_guard<std::mutex>  lg(mut_set_alloc_info);
+      set_alloc_info.emplace(block);
+    }
+  #endif
+#endif
+#if defined(DEF_Heap_profile)
+    fast_mem_pool_profiler.on_alloc(re,  allocation_size);
+#endif
+#if defined(DEF_Alloc_trace)
+    fast_mem_pool_tracer.on_fmalloc(allocation_size,  OS_malloc_id,  FastMemPoolTracePath::OS_malloc);
+#endif
+    return  re;
+  }
+
+  // Memory pool, buffers are read-only after the constructor and kept apart from the mutable Leaf states:
+  char  *leaf_buf[Leaf_Cnt];
+  Leaf  leaf_array[Leaf_Cnt];
+  alignas(Leaf_Align)  std::atomic<int>  cur_leaf  {  0  };
+#if defined(DEF_Cache_line_isolation)
+  char  cur_leaf_pad[Leaf_Align  -  sizeof(std::atomic<int>)];
+#endif
+
+  /*
+    Lifetime groups: the leaves of the pool (of a NUMA node) are split into Short (the first half),
+    Medium and Long (a quarter each) groups, each group rotates its own cursor.
+    Fewer than Lifetime_Groups leaves: every group is the whole range.
+  */
+  static constexpr int  Lifetime_Groups  {  3  };
+  static constexpr int  lifetime_first(int  first,  int  cnt,  int  group)
+  {
+    return  cnt  <  Lifetime_Groups  ?  first
+      :  first  +  (0  ==  group  ?  0  :  cnt  -  (Lifetime_Groups  -  group)  *  std::max(1,  cnt  /  4));
+  }
+  static constexpr int  lifetime_cnt(int  first,  int  cnt,  int  group)
+  {
+    return  Lifetime_Groups  -  1  ==  group  ||  cnt  <  Lifetime_Groups  ?  first  +  cnt  -  lifetime_first(first,  cnt,  group)
+      :  lifetime_first(first,  cnt,  group  +  1)  -  lifetime_first(first,  cnt,  group);
+  }
+#if defined(DEF_Lifetime_groups) && !defined(DEF_NUMA)
+  struct alignas(Leaf_Align) LifetimeCursor
+  {
+    std::atomic<int>  cur_leaf;
+  };
+  LifetimeCursor  lifetime_cur[Lifetime_Groups]  {
+    {  lifetime_first(0,  Leaf_Cnt,  0)  },  {  lifetime_first(0,  Leaf_Cnt,  1)  },  {  lifetime_first(0,  Leaf_Cnt,  2)  }  };
+#else
+  static constexpr std::atomic<int>  *lifetime_cur  {  nullptr  };
+#endif
+
+  /**
+   * @brief lifetime_alloc - leaf_group_alloc in the leaves [first, first + cnt) of the pool or of a NUMA node:
+   * with DEF_Lifetime_groups the group of the hint first, then the other groups, else with the one cursor
+   */
+  template<class Cursor>
+  char  * lifetime_alloc(int  first,  int  cnt,  std::atomic<int>  &cursor,  Cursor  *lifetime_cursor,  LifetimeHint  hint,
+                         int  real_size,  int  &leaf_id,  int  &start_leaf,  bool  &rotated,  int  *grown)
+  {
+#if defined(DEF_Lifetime_groups)
+    (void)cursor;
+    for (int  i  =  0;  i  <  Lifetime_Groups;  ++i)
+    {
+      const int  group  =  (static_cast<int>(hint)  +  i)  %  Lifetime_Groups;
+      char  *re  =  leaf_group_alloc(lifetime_first(first,  cnt,  group),  lifetime_cnt(first,  cnt,  group),
+                                     lifetime_cursor[group].cur_leaf,  real_size,  leaf_id,  start_leaf,  rotated,  grown);
+      if (re)  {  return  re;  }
+    }
+    return  nullptr;
+#else
+    (void)lifetime_cursor;
+    (void)hint;
+    return  leaf_group_alloc(first,  cnt,  cursor,  real_size,  leaf_id,  start_leaf,  rotated,  grown);
+#endif
+  }
+
+  /**
+   * @brief leaf_release - account returned bytes of the leaf, reset it when everything is returned
+   * @param leaf_id  -  leaf
+   * @param bytes  -  returned bytes (allocation with AllocHeader)
+   * @return - true if the leaf was reset
+   */
+  bool  leaf_release(int  leaf_id,  int  bytes)
+  {
+    uint64_t  state  =  leaf_array[leaf_id].state.fetch_add(bytes, std::memory_order_acq_rel)  +  bytes;
+    if (state_deallocated(state)  == (Leaf_Size_Bytes - state_available(state)))
+    {  // everything that was allocated is now returned, we will try, carefully, reset the Leaf.
+      // If the state went back to the same value meanwhile, everything is returned again, so the reset is still right:
+      if (leaf_array[leaf_id].state.compare_exchange_strong(state,  leaf_state(Leaf_Size_Bytes,  0),
+            std::memory_order_acq_rel,  std::memory_order_relaxed))
+      {
+        return  true;
+      }
+#if defined(DEF_Contention_profile)
+      contention[leaf_id].reset_cas_fails.fetch_add(1,  std::memory_order_relaxed);
+#endif
+    }
+    return  false;
+  }
+
+  /**
+   * @brief leaf_group_alloc - search a place in the leaves [first, first + cnt) starting from the group cursor
+   * @param first  -  first leaf of the group
+   * @param cnt  -  leaves in the group
+   * @param cursor  -  current leaf of the group (leaf id)
+   * @param real_size  -  allocation size with AllocHeader
+   * @param leaf_id  -  where the allocation was done
+   * @param start_leaf  -  where the search started
+   * @param rotated  -  true if the allocation depleted the leaf and moved the cursor
+   * @param grown  -  nullptr: exactly real_size, else [out] the bytes taken over real_size (fmalloc_at_least)
+   * @return - allocation (AllocHeader is not filled yet) or nullptr if the group is depleted
+   */
+  char  * leaf_group_alloc(int  first,  int  cnt,  std::atomic<int>  &cursor,  int  real_size,
+                           int  &leaf_id,  int  &start_leaf,  bool  &rotated,  int  *grown  =  nullptr)
+  {
+    // Starting leaf for finding the allocation place:
+    start_leaf  =  cursor.load(std::memory_order_relaxed);
+    leaf_id  =  start_leaf;
+    const int  end_leaf  =  first  +  cnt;
+    // Resulting allocation:
+    char  *re  =  nullptr;
+    // Exit the loop at the end of the loop when we meet start_leaf again:
+    do {
+      uint64_t  state  =  leaf_array[leaf_id].state.load(std::memory_order_acquire);
+      /*
+        We reserve memory (the buffer is distributed from the end with a bite) with CAS,
+        so "available" never breaks through the bottom of the buffer: a lost race just reloads
+        the state and retries while the leaf still has room. (With fetch_sub the loser of the race
+        had to drop its overshoot, the leaf could never match deallocated and was lost to the pool.)
+      */
+      while (state_available(state)  >=  real_size)
+      {
+        const int  take  =  grown  ?  grow_take(state_available(state),  real_size)  :  real_size;
+        const int  available_after  =  state_available(state)  -  take;
+        if (leaf_array[leaf_id].state.compare_exchange_weak(state,
+              state  -  (static_cast<uint64_t>(take)  <<  32),
+              std::memory_order_acq_rel,  std::memory_order_acquire))
+        {  // the resulting distribution address is easy to obtain, because it starts immediately
+          // after "available", since addressing from &[0] then this is "buf + available":
+          re  =  leaf_buf[leaf_id] + available_after;
+          if (grown)  {  *grown  =  take  -  real_size;  }
+          if (available_after < Average_Allocation)
+          {  // Let's tell the rest of the threads to use a different memory page:
+            const int next_id = start_leaf + 1;
+            if (next_id >= end_leaf)
+            {
+              cursor.store(first, std::memory_order_release);
+            } else {
+              cursor.store(next_id, std::memory_order_release);
+            }
+            rotated  =  true;
+#if defined(DEF_Contention_profile)
+            contention[leaf_id].cur_leaf_stores.fetch_add(1,  std::memory_order_relaxed);
+#endif
+          }
+          break;
+        }
+#if defined(DEF_Contention_profile)
+        contention[leaf_id].reserve_retries.fetch_add(1,  std::memory_order_relaxed);
+#endif
+      }
+      if (re)  {  break;  }  // finished the search, return the allocation pointer
+      ++leaf_id;
+      if (end_leaf == leaf_id)  {  leaf_id  =  first;  }
+    } while (leaf_id  !=  start_leaf);
+#if defined(DEF_Contention_profile)
+    contention_on_scan(start_leaf,  re  ?  (leaf_id  -  start_leaf  +  cnt)  %  cnt  :  Leaf_Cnt);
+#endif
+    return  re;
+  }  // leaf_group_alloc
+
+  /**
+   * @brief grow_take - bytes fmalloc_at_least takes from a leaf with available bytes:
+   * the leaf tail that would stay under Average_Allocation, else real_size plus the bytes
+   * down to the cache line boundary (the allocation starts on a cache line)
+   */
+  static constexpr int  grow_take(int  available,  int  real_size)
+  {
+    return  available  -  real_size  <  Average_Allocation  ?  available
+      :  available  -  ((available  -  real_size)  &  ~(static_cast<int>(DEF_Cache_line_Bytes)  -  1));
+  }
+
+  // the next leaf for FastMemPoolProvision::Lazy, Leaf_Cnt - all leaves are provisioned:
+  std::atomic<int>  lazy_next  {  Leaf_Cnt  };
+  static constexpr std::size_t  Page_Bytes  {  4096  };
+
+  /**
+   * @brief claim_free_leaf - a fully available leaf becomes private (ScopedArena, epochs):
+   * it looks depleted to fmalloc and to the other claims, leaf_release never resets it.
+   * The search goes from the last leaf down, far from the cur_leaf rotation.
+   * @return - leaf id or -1 if no leaf is fully available (and no more can be provisioned)
+   */
+  int  claim_free_leaf()
+  {
+    do  {
+      for (int  leaf_id  =  Leaf_Cnt  -  1;  leaf_id  >=  0;  --leaf_id)
+      {
+        uint64_t  state  =  leaf_state(Leaf_Size_Bytes,  0);
+        if (leaf_buf[leaf_id]
+            &&  leaf_array[leaf_id].state.compare_exchange_strong(state,  leaf_state(0,  0),
+                  std::memory_order_acq_rel,  std::memory_order_relaxed))
+        {
+          return  leaf_id;
+        }
+      }
+#if defined(DEF_NUMA)
+    }  while (provision_leaf(current_numa_node()));
+#else
+    }  while (provision_leaf());
+#endif
+    return  -1;
+  }
+
+  // AllocHeader of the leaf allocation re (real_size with the header), returns the user pointer:
+  char  * put_header(char  *re,  int  leaf_id,  int  real_size)
+  {
+    AllocHeader  *head  =  reinterpret_cast<AllocHeader  *>(re);
+    head->leaf_id  =  leaf_id;
+    head->tag_this  =  ((uint64_t)this)  +  leaf_id;
+    head->size  =  real_size  -  static_cast<int>(sizeof(AllocHeader));
+#if defined(DEF_Alloc_site)
+    head->site_id  =  0;
+#endif
+    return  re  +  sizeof(AllocHeader);
+  }
+
+  /*
+    Epochs: up to Epoch_Slots epochs live at the same time. The leaves of an epoch are claimed
+    with claim_free_leaf() and tagged in leaf_epoch with slot + 1, free_epoch() resets the tagged ones.
+    The slot cursor packs (leaf id + 1, available) of the current leaf of the epoch, threads bump it with CAS.
+  */
+  static constexpr int  Epoch_Slots  {  DEF_Epoch_Slots  };
+  struct alignas(DEF_Cache_line_Bytes) EpochSlot
+  {
+    // epoch + 1, 0 - the slot is free:
+    std::atomic<uint64_t>  key  {  0  };
+    std::atomic<uint64_t>  cursor  {  0  };
+  };
+  EpochSlot  epoch_slots[Epoch_Slots];
+  std::atomic<int>  leaf_epoch[Leaf_Cnt]  {};
+#if defined(DEF_Alloc_site)
+  // available + 1 of a ScopedArena leaf or of a passed epoch leaf for dump_live_by_site(), 0 - the leaf state has it:
+  std::atomic<int>  private_cursor[Leaf_Cnt]  {};
+#endif
+  // only a new epoch takes it:
+  std::atomic<bool>  epoch_lock  {  false  };
+
+  static constexpr uint64_t  epoch_cursor(int  leaf_id,  int  available)
+  {
+    return  (static_cast<uint64_t>(leaf_id  +  1)  <<  32)  |  static_cast<uint32_t>(available);
+  }
+
+  /**
+   * @brief epoch_slot - the slot of the epoch
+   * @param epoch  -  epoch id
+   * @param create  -  take a free slot if the epoch has none
+   * @return - slot or nullptr (no such epoch or every slot is taken)
+   */
+  EpochSlot  * epoch_slot(uint64_t  epoch,  bool  create)
+  {
+    const uint64_t  key  =  epoch  +  1;
+    if (0  ==  key)  {  return  nullptr;  }
+    for (auto  &&slot  :  epoch_slots)
+    {
+      if (key  ==  slot.key.load(std::memory_order_acquire))  {  return  &slot;  }
+    }
+    if (!create)  {  return  nullptr;  }
+    // rare path: one thread at a time looks again and takes a slot, the same epoch never gets two
+    while (epoch_lock.exchange(true,  std::memory_order_acquire))  {  std::this_thread::yield();  }
+    EpochSlot  *re  =  nullptr;
+    for (auto  &&slot  :  epoch_slots)
+    {
+      if (key  ==  slot.key.load(std::memory_order_acquire))  {  re  =  &slot;  break;  }
+    }
+    for (int  i  =  0;  !re  &&  i  <  Epoch_Slots;  ++i)
+    {
+      uint64_t  expected  =  0;
+      if (epoch_slots[i].key.compare_exchange_strong(expected,  key,  std::memory_order_acq_rel))
+      {
+        re  =  &epoch_slots[i];
+      }
+    }
+    epoch_lock.store(false,  std::memory_order_release);
+    return  re;
+  }
+
+#if defined(DEF_Pool_registry)
+  // FastMemPoolRegistry owner id of this pool:
+  int  registry_id  {  -1  };
+
+  static void  registry_free(void  *pool,  void  *ptr)
+  {
+    static_cast<FastMemPool  *>(pool)->ffree(ptr);
+  }
+
+  static bool  registry_owns(const void  *pool,  const void  *ptr)
+  {
+    return  static_cast<const FastMemPool  *>(pool)->owns(ptr);
+  }
+
+  // OS malloc fallbacks have the same header in every pool:
+  static bool  registry_free_os(void  *ptr)
+  {
+  #if defined(DEF_Auto_deallocate) && !defined(Debug)
+    // the owner keeps it in set_alloc_info and frees it in its destructor
+    (void)ptr;
+    return  false;
+  #else
+    AllocHeader  *head  =  reinterpret_cast<AllocHeader  *>(static_cast<char  *>(ptr)  -  sizeof(AllocHeader));
+    if (!os_header(head))  {  return  false;  }
+    #if defined(DEF_Alloc_trace)
+    fast_mem_pool_tracer.on_ffree(head->size,  OS_malloc_id,  FastMemPoolTracePath::OS_malloc);
+    #endif
+    void  *block  =  os_block(head);
+    memset(head,  0,  sizeof(AllocHeader));
+    free(block);
+    return  true;
+  #endif
+  }
+#endif
+
+#if defined(DEF_NUMA)
+  /*
+    NUMA: the leaves are split into numa_nodes contiguous groups, group n is bound to node n
+    (mbind MPOL_PREFERRED, so a full node spills over instead of OOM), each group has its own cursor.
+    With one node (or without the syscalls) there is one group over all leaves: the usual pool.
+  */
+  static constexpr int  NUMA_Max_Nodes  {  DEF_NUMA_Max_Nodes  <  Leaf_Cnt  ?  DEF_NUMA_Max_Nodes  :  Leaf_Cnt  };
+  struct alignas(DEF_Cache_line_Bytes) NumaNode
+  {
+    std::atomic<int>  cur_leaf  {  0  };
+    int  first_leaf  {  0  };
+    int  leaf_cnt  {  Leaf_Cnt  };
+#if defined(DEF_Lifetime_groups)
+    // cursors of the lifetime groups of the node:
+    struct  {  std::atomic<int>  cur_leaf  {  0  };  }  lifetime_cur[Lifetime_Groups];
+#else
+    static constexpr std::atomic<int>  *lifetime_cur  {  nullptr  };
+#endif
+    // FastMemPoolProvision::Lazy, the next leaf of the group:
+    std::atomic<int>  lazy_next  {  Leaf_Cnt  };
+    // slow path counters only, the local fast path is not counted:
+    std::atomic<uint64_t>  remote_allocs  {  0  };
+    std::atomic<uint64_t>  os_allocs  {  0  };
+  };
+  NumaNode  numa_node[NUMA_Max_Nodes];
+  // leaf groups:
+  int  numa_nodes  {  1  };
+  // online nodes of the machine, mbind is used only if > 1:
+  int  numa_hw_nodes  {  1  };
+
+  static int  numa_online_nodes()
+  {
+#if defined(__linux__)
+    // "0" or "0-3" or "0,2-3": the last number is the highest node
+    std::ifstream  online("/sys/devices/system/node/online");
+    std::string  line;
+    if (online  &&  std::getline(online,  line))
+    {
+      const std::size_t  pos  =  line.find_last_of(",-");
+      const int  last  =  atoi(line.c_str()  +  (std::string::npos  ==  pos  ?  0  :  pos  +  1));
+      if (last  >  0)  {  return  last  +  1;  }
+    }
+#endif
+    return  1;
+  }
+
+  void  numa_init(bool  lazy)
+  {
+    numa_hw_nodes  =  std::min(numa_online_nodes(),  NUMA_Max_Nodes);
+    numa_nodes  =  DEF_NUMA_Nodes  >  0  ?  DEF_NUMA_Nodes  :  numa_hw_nodes;
+    numa_nodes  =  std::max(1,  std::min(numa_nodes,  NUMA_Max_Nodes));
+    for (int  n  =  0;  n  <  numa_nodes;  ++n)
+    {
+      NumaNode  &group  =  numa_node[n];
+      group.first_leaf  =  n  *  Leaf_Cnt  /  numa_nodes;
+      group.leaf_cnt  =  (n  +  1)  *  Leaf_Cnt  /  numa_nodes  -  group.first_leaf;
+      group.cur_leaf.store(group.first_leaf,  std::memory_order_relaxed);
+#if defined(DEF_Lifetime_groups)
+      for (int  g  =  0;  g  <  Lifetime_Groups;  ++g)
+      {
+        group.lifetime_cur[g].cur_leaf.store(lifetime_first(group.first_leaf,  group.leaf_cnt,  g),  std::memory_order_relaxed);
+      }
+#endif
+      group.lazy_next.store(lazy  ?  group.first_leaf  :  Leaf_Cnt,  std::memory_order_relaxed);
+    }
+  }
+
+  int  numa_group_of(int  leaf_id)  const
+  {
+    // (one group: the compiler must not see numa_node[1] at all)
+    if constexpr (1  ==  NUMA_Max_Nodes)  {  (void)leaf_id;  return  0;  }
+    int  n  =  std::min(numa_nodes,  NUMA_Max_Nodes)  -  1;
+    while (n  >  0  &&  leaf_id  <  numa_node[n].first_leaf)  {  --n;  }
+    return  n;
+  }
+
+  // leaf group of the calling thread (fmalloc hot path: the CPU and node are cached by the thread):
+  int  current_numa_node()  const
+  {
+    if (1  ==  numa_nodes)  {  return  0;  }
+#if defined(__linux__)
+    struct  ThreadCpu  {  unsigned  cpu;  unsigned  node;  int  countdown;  };
+    static thread_local  ThreadCpu  where  {  0,  0,  0  };
+    if (--where.countdown  <  0)
+    {
+      where.countdown  =  DEF_NUMA_Refresh;
+  #if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 29)
+      // (vDSO, no kernel entry)
+      const int  re  =  getcpu(&where.cpu,  &where.node);
+  #elif defined(SYS_getcpu)
+      const int  re  =  static_cast<int>(syscall(SYS_getcpu,  &where.cpu,  &where.node,  nullptr));
+  #else
+      const int  re  =  -1;
+  #endif
+      if (0  !=  re)  {  where.cpu  =  where.node  =  0;  }
+    }
+    // emulated nodes are spread over the CPUs:
+    return  static_cast<int>((numa_hw_nodes  >  1  ?  where.node  :  where.cpu)  %  numa_nodes);
+#else
+    return  0;
+#endif
+  }
+
+  void  numa_bind_leaf(int  leaf_id)
+  {
+#if defined(__linux__) && defined(SYS_mbind)
+    const int  node  =  numa_group_of(leaf_id);
+    if (numa_hw_nodes  <  2  ||  node  >=  numa_hw_nodes  ||  !leaf_buf[leaf_id])  {  return;  }
+    // whole pages inside the leaf, the edges may be shared with the neighbours:
+    const uintptr_t  start  =  (reinterpret_cast<uintptr_t>(leaf_buf[leaf_id])  +  Page_Bytes  -  1)  &  ~(Page_Bytes  -  1);
+    const uintptr_t  end  =  (reinterpret_cast<uintptr_t>(leaf_buf[leaf_id])  +  Leaf_Size_Bytes)  &  ~(Page_Bytes  -  1);
+    if (start  >=  end)  {  return;  }
+    unsigned long  mask  =  1UL  <<  node;
+    // MPOL_PREFERRED == 1, MPOL_MF_MOVE == 2 (no libnuma needed), on failure the leaf stays first touch:
+    syscall(SYS_mbind,  start,  end  -  start,  1,  &mask,  sizeof(mask)  *  8,  2);
+#endif
+  }
+#endif
+
+  /**
+   * @brief provision_leaf - FastMemPoolProvision::Lazy: make the next leaf ready
+   * @param node  -  (DEF_NUMA) the leaf group of the caller is provisioned first
+   * @return - false if there are no more leaves to provision
+   */
+#if defined(DEF_NUMA)
+  bool  provision_leaf(int  node)
+  {
+    for (int  i  =  0;  i  <  numa_nodes;  ++i)
+    {
+      NumaNode  &group  =  numa_node[(node  +  i)  %  numa_nodes];
+      if (provision_leaf(group.lazy_next,  group.first_leaf  +  group.leaf_cnt,  group.cur_leaf))  {  return  true;  }
+    }
+    return  false;
+  }
+#else
+  bool  provision_leaf()
+  {
+    return  provision_leaf(lazy_next,  Leaf_Cnt,  cur_leaf);
+  }
+#endif
+
+  bool  provision_leaf(std::atomic<int>  &next,  int  end_leaf,  std::atomic<int>  &cursor)
+  {
+    if (next.load(std::memory_order_relaxed)  >=  end_leaf)  {  return  false;  }
+    const int  leaf_id  =  next.fetch_add(1,  std::memory_order_acq_rel);
+    if (leaf_id  >=  end_leaf)  {  return  false;  }
+#if !defined(DEF_Leaf_mmap)
+    // (published by the release store of the state, fmalloc reads the buffer after its CAS on the state)
+    leaf_buf[leaf_id]  =  static_cast<char *>(malloc(Leaf_Size_Bytes));
+  #if defined(DEF_NUMA)
+    numa_bind_leaf(leaf_id);
+  #endif
+  #if defined(DEF_Pool_registry)
+    fast_mem_pool_registry.add_range(registry_id,  leaf_buf[leaf_id],  Leaf_Size_Bytes);
+  #endif
+#endif
+    if (leaf_buf[leaf_id])
+    {
+      leaf_array[leaf_id].state.store(leaf_state(Leaf_Size_Bytes,  0),  std::memory_order_release);
+      cursor.store(leaf_id,  std::memory_order_release);
+    }
+    return  true;
+  }
+
+  // write a byte of each page:
+  static void  touch_pages(char  *buf,  std::size_t  bytes)
+  {
+    volatile char  *vbuf  =  buf;
+    for (std::size_t  offset  =  0;  offset  <  bytes;  offset  +=  Page_Bytes)
+    {
+      vbuf[offset]  =  0;
+    }
+    vbuf[bytes  -  1]  =  0;
+  }
+
+  static void  prefault_leaf(char  *buf)
+  {
+    if (!buf)  {  return;  }
+#if defined(MADV_POPULATE_WRITE)
+    // whole pages inside the leaf are populated by the kernel in one call, the edges are shared with the neighbours:
+    char  *start  =  reinterpret_cast<char  *>((reinterpret_cast<uintptr_t>(buf)  +  Page_Bytes  -  1)  &  ~(Page_Bytes  -  1));
+    char  *end  =  reinterpret_cast<char  *>((reinterpret_cast<uintptr_t>(buf)  +  Leaf_Size_Bytes)  &  ~(Page_Bytes  -  1));
+    if (start  <  end  &&  0  ==  madvise(start,  end  -  start,  MADV_POPULATE_WRITE))
+    {
+      buf[0]  =  0;
+      buf[Leaf_Size_Bytes  -  1]  =  0;
+      return;
+    }
+#endif
+    touch_pages(buf,  Leaf_Size_Bytes);
+  }
+
+  void  pretouch_leaves(int  threads_cnt)
+  {
+    if (threads_cnt  <=  0)  {  threads_cnt  =  static_cast<int>(std::thread::hardware_concurrency());  }
+    threads_cnt  =  std::max(1,  std::min(threads_cnt,  Leaf_Cnt));
+    auto  worker  =  [this,  threads_cnt](int  first)  {
+      for (int   i  =  first;  i  < Leaf_Cnt ;  i  +=  threads_cnt)
+      {
+        if (leaf_buf[i])  {  touch_pages(leaf_buf[i],  Leaf_Size_Bytes);  }
+      }
+    };
+    std::vector<std::thread>  helpers;
+    int  started  =  1;
+    try {
+      for (;  started  <  threads_cnt;  ++started)
+      {
+        helpers.emplace_back(worker,  started);
+      }
+    } catch (...) {
+      // no more threads: the rest is done here
+    }
+    worker(0);
+    for (int  first  =  started;  first  <  threads_cnt;  ++first)
+    {
+      worker(first);
+    }
+    for (auto  &&it  :  helpers)
+    {
+      it.join();
+    }
+  }
+
+#if defined(DEF_Leaf_mmap)
+  #if defined(DEF_Headerless_small)
+  // masking needs Leaf_Size_Bytes to be a power of 2, otherwise this pool has no small leaves:
+  static constexpr bool  Headerless_small  {  Leaf_Size_Bytes  >=  1024  &&  0  ==  (Leaf_Size_Bytes  &  (Leaf_Size_Bytes  -  1))  };
+  // small leaves follow the usual leaves:
+  static constexpr int  Small_Leaf_Cnt  {  Headerless_small  ?  DEF_Small_Leaf_Cnt  :  0  };
+  static constexpr std::size_t  Small_Base_Align  {  Headerless_small  ?  static_cast<std::size_t>(Leaf_Size_Bytes)  :  1  };
+  #else
+  static constexpr int  Small_Leaf_Cnt  {  0  };
+  static constexpr std::size_t  Small_Base_Align  {  1  };
+  #endif
+  #if defined(DEF_Rseq_slots)
+  // slot chunks are aligned inside the leaves, so the chunk start is known from any address in it:
+  static constexpr std::size_t  Rseq_Chunk_Bytes  {  DEF_Rseq_Chunk_Bytes  };
+  static constexpr bool  Rseq_slots  {  0  ==  Leaf_Size_Bytes  %  Rseq_Chunk_Bytes  };
+  static constexpr std::size_t  Rseq_Max_Bytes  {  Rseq_slots  ?  DEF_Rseq_Max_Bytes  :  0  };
+  static constexpr std::size_t  Rseq_Base_Align  {  Rseq_slots  ?  Rseq_Chunk_Bytes  :  1  };
+  #else
+  static constexpr std::size_t  Rseq_Base_Align  {  1  };
+  #endif
+  static constexpr std::size_t  Leaf_Base_Align  {  Small_Base_Align  >  Rseq_Base_Align  ?  Small_Base_Align  :  Rseq_Base_Align  };
+  static constexpr std::size_t  Leaf_Range_Bytes  {  static_cast<std::size_t>(Leaf_Size_Bytes)  *  (Leaf_Cnt  +  Small_Leaf_Cnt)  };
+  static constexpr std::size_t  Leaf_Map_Bytes  {  Leaf_Range_Bytes  +  Leaf_Base_Align  -  1  };
+  // the mapping and all leaves in one contiguous range inside it (nullptr if the reservation failed):
+  char  *leaf_map  {  nullptr  };
+  char  *leaf_base  {  nullptr  };
+
+  /**
+   * @brief own_leaf_id
+   * @param ptr  -  any address
+   * @return - leaf id if ptr lies in the leaves range, otherwise -1 (only arithmetic, nothing is read)
+   */
+  int  own_leaf_id(const void  *ptr)  const
+  {
+    const uintptr_t  offset  =  reinterpret_cast<uintptr_t>(ptr)  -  reinterpret_cast<uintptr_t>(leaf_base);
+    if (leaf_base  &&  offset  <  Leaf_Range_Bytes)
+    {
+      return  static_cast<int>(offset  /  Leaf_Size_Bytes);
+    }
+    return  -1;
+  }
+#endif
+
+#if defined(DEF_Rseq_slots)
+  /*
+    Per-CPU slots: each CPU has the end of its chunk (aligned Rseq_Chunk_Bytes inside a leaf)
+    as one word, the allocations are cut downwards from it. The slot is changed only by
+    rseq_cmp_store() on its own CPU: preemption, migration or a signal restarts the sequence,
+    so the bump needs no lock prefix. The leaf accounting is the usual one: the chunk is reserved
+    from the leaf with a CAS, ffree returns the allocations, the retired rest of the chunk is returned
+    by the refill. A depleted chunk is stored as 0, so a slot value is always inside its chunk.
+  */
+  struct alignas(DEF_Cache_line_Bytes) CpuSlot
+  {
+    uintptr_t  cur  {  0  };
+  };
+  CpuSlot  cpu_slot[DEF_Rseq_Max_Cpus];
+
+  static uintptr_t  chunk_start(uintptr_t  cur)
+  {
+    return  (cur  -  1)  &  ~static_cast<uintptr_t>(Rseq_Chunk_Bytes  -  1);
+  }
+
+  #if defined(FMP_RSEQ)
+  static bool  rseq_ready()
+  {
+    return  __rseq_size  >  0;
+  }
+
+  // cpu_id of the calling thread from its rseq area, -1 if it is not registered:
+  static int  rseq_cpu()
+  {
+    int  cpu;
+    __asm__ __volatile__ ("movl %%fs:4(%1), %0"  :  "=r" (cpu)  :  "r" (static_cast<long>(__rseq_offset)));
+    return  cpu;
+  }
+
+  /**
+   * @brief rseq_cmp_store - on CPU cpu: if *slot == expect then *slot = newv, as one restartable sequence
+   * @return - 0 done, 1 the slot has other value, -1 aborted (preempted, migrated or signal)
+   */
+  static int  rseq_cmp_store(uintptr_t  *slot,  uintptr_t  expect,  uintptr_t  newv,  int  cpu)
+  {
+    // struct rseq: cpu_id at 4, rseq_cs at 8; the abort handler is preceded by RSEQ_SIG.
+    // "?" keeps the descriptor in the COMDAT group of the code, so both are discarded together:
+    __asm__ __volatile__ goto (
+      ".pushsection __rseq_cs, \"aw?\"\n\t"
+      ".balign 32\n\t"
+      "3:\n\t"
+      ".long 0x0, 0x0\n\t"
+      ".quad 1f, (2f - 1f), 4f\n\t"
+      ".popsection\n\t"
+      "leaq 3b(%%rip), %%rax\n\t"
+      "movq %%rax, %%fs:8(%[rseq_offset])\n\t"
+      "1:\n\t"
+      "cmpl %[cpu_id], %%fs:4(%[rseq_offset])\n\t"
+      "jnz 4f\n\t"
+      "cmpq %[v], %[expect]\n\t"
+      "jnz %l[cmpfail]\n\t"
+      "movq %[newv], %[v]\n\t"
+      "2:\n\t"
+      ".pushsection __rseq_failure, \"ax?\"\n\t"
+      ".long 0x53053053\n\t"
+      "4:\n\t"
+      "jmp %l[abort]\n\t"
+      ".popsection\n\t"
+      :
+      :  [cpu_id] "r" (cpu),  [rseq_offset] "r" (static_cast<long>(__rseq_offset)),
+         [v] "m" (*slot),  [expect] "r" (expect),  [newv] "r" (newv)
+      :  "memory",  "cc",  "rax"
+      :  abort,  cmpfail);
+    return  0;
+  abort:
+    return  -1;
+  cmpfail:
+    return  1;
+  }
+  #endif
+
+  /**
+   * @brief cpu_slot_alloc - bump allocation from the chunk of the current CPU
+   * @param real_size  -  allocation size with AllocHeader
+   * @return - allocation or nullptr (no rseq, no chunk): the caller goes to the leaves
+   */
+  char  * cpu_slot_alloc(int  real_size)
+  {
+  #if defined(FMP_RSEQ)
+    if (!rseq_ready())  {  return  nullptr;  }
+    for (int  attempt  =  0;  attempt  <  4;  ++attempt)
+    {
+      const int  cpu  =  rseq_cpu();
+      if (cpu  <  0  ||  cpu  >=  DEF_Rseq_Max_Cpus)  {  return  nullptr;  }
+      uintptr_t  *slot  =  &cpu_slot[cpu].cur;
+      const uintptr_t  cur  =  *static_cast<volatile uintptr_t  *>(slot);
+      const uintptr_t  start  =  chunk_start(cur);
+      // (the rest of the chunk is 0 or has room for the padding header of retire_chunk)
+      if (cur  &&  cur  -  start  >=  static_cast<uintptr_t>(real_size)
+          &&  (cur  -  start  ==  static_cast<uintptr_t>(real_size)
+               ||  cur  -  start  >=  real_size  +  sizeof(AllocHeader)))
+      {
+        const uintptr_t  next  =  cur  -  real_size;
+        if (0  ==  rseq_cmp_store(slot,  cur,  next  ==  start  ?  0  :  next,  cpu))
+        {
+          return  reinterpret_cast<char  *>(cur  -  real_size);
+        }
+        continue;
+      }
+      // the chunk is over, the new one replaces it only if the slot is still the same on this CPU:
+      const uintptr_t  chunk_end  =  take_chunk();
+      if (!chunk_end)  {  return  nullptr;  }
+      if (0  ==  rseq_cmp_store(slot,  cur,  chunk_end,  cpu))
+      {
+        if (cur)  {  retire_chunk(cur);  }
+      }  else  {
+        retire_chunk(chunk_end);
+      }
+    }
+  #else
+    (void)real_size;
+  #endif
+    return  nullptr;
+  }
+
+  // return the unused part of the chunk to its leaf:
+  void  retire_chunk(uintptr_t  cur)
+  {
+    const uintptr_t  start  =  chunk_start(cur);
+    // it looks like a freed allocation (as the padding of fmalloc_aligned), the leaf walk steps over it:
+    AllocHeader  *head  =  reinterpret_cast<AllocHeader  *>(start);
+    head->tag_this  =  0;
+    head->leaf_id  =  0;
+    head->size  =  static_cast<int>(cur  -  start  -  sizeof(AllocHeader));
+    leaf_release(own_leaf_id(reinterpret_cast<char  *>(start)),  static_cast<int>(cur  -  start));
+  }
+
+  /**
+   * @brief take_chunk - reserve the leaf tail down to the chunk alignment
+   * @return - the chunk end (the start is chunk_start(end)) or 0 if the leaves are depleted
+   */
+  uintptr_t  take_chunk()
+  {
+  #if defined(DEF_NUMA)
+    const int  node  =  current_numa_node();
+    for (int  i  =  0;  i  <  numa_nodes;  ++i)
+    {
+      NumaNode  &group  =  numa_node[(node  +  i)  %  numa_nodes];
+      const uintptr_t  chunk_end  =  take_chunk(group.first_leaf,  group.leaf_cnt,  group.cur_leaf);
+      if (chunk_end)  {  return  chunk_end;  }
+    }
+    return  0;
+  #else
+    return  take_chunk(0,  Leaf_Cnt,  cur_leaf);
+  #endif
+  }
+
+  uintptr_t  take_chunk(int  first,  int  cnt,  std::atomic<int>  &cursor)
+  {
+    const int  start_leaf  =  cursor.load(std::memory_order_relaxed);
+    int  leaf_id  =  start_leaf;
+    do {
+      uint64_t  state  =  leaf_array[leaf_id].state.load(std::memory_order_acquire);
+      while (state_available(state)  >  0)
+      {
+        const int  available  =  state_available(state);
+        const int  available_after  =  (available  -  1)  &  ~static_cast<int>(Rseq_Chunk_Bytes  -  1);
+        // a tail under AllocHeader holds no allocation and no padding header of retire_chunk:
+        if (available  -  available_after  <  static_cast<int>(sizeof(AllocHeader)))  {  break;  }
+        if (leaf_array[leaf_id].state.compare_exchange_weak(state,
+              state  -  (static_cast<uint64_t>(available  -  available_after)  <<  32),
+              std::memory_order_acq_rel,  std::memory_order_acquire))
+        {
+          if (available_after  <  Average_Allocation)
+          {  // the leaf is depleted:
+            cursor.store(leaf_id  +  1  <  first  +  cnt  ?  leaf_id  +  1  :  first,  std::memory_order_release);
+          }
+          return  reinterpret_cast<uintptr_t>(leaf_buf[leaf_id]  +  available);
+        }
+      }
+      ++leaf_id;
+      if (first  +  cnt  ==  leaf_id)  {  leaf_id  =  first;  }
+    } while (leaf_id  !=  start_leaf);
+    return  0;
+  }
+#endif
+
+#if defined(DEF_Headerless_small)
+  /*
+    Headerless small allocations:
+    each small leaf serves one size class, its first cache line is SmallLeaf,
+    then the live bitmap (one bit per object), the slack bytes (size class - requested size,
+    so check_access stays exact) and then the objects themselves.
+    A pointer finds its SmallLeaf by masking: ptr & ~(Leaf_Size_Bytes - 1).
+    Returned objects go to a lock-free free list of the leaf, the next index is kept in the object,
+    the head has an ABA counter in the high 32 bits and (object index + 1) in the low ones.
+    DEF_Small_bitmap: no free list, the live bitmap is the allocator: fmalloc finds a zero bit
+    with count trailing zeros from the scan_word hint and takes it with fetch_or, ffree is fetch_and.
+    Nothing is written into a free object and there is no list head to race on (no ABA),
+    the lowest free object is taken first (address ordered, as the hint goes down on ffree).
+  */
+  static constexpr std::size_t  Small_Max_Bytes  {  256  };
+  // 16, 32 .. 128 step 16, then 160, 192, 224, 256:
+  static constexpr int  Small_Class_Cnt  {  12  };
+  static constexpr int  small_class(std::size_t  size)
+  {
+    return  size  <=  128  ?  (size  ?  static_cast<int>((size  +  15)  /  16)  -  1  :  0)
+                           :  8  +  static_cast<int>((size  -  129)  /  32);
+  }
+  static constexpr int  small_class_size(int  size_class)
+  {
+    return  size_class  <  8  ?  (size_class  +  1)  *  16  :  128  +  (size_class  -  7)  *  32;
+  }
+
+  struct alignas(DEF_Cache_line_Bytes) SmallLeaf {
+    std::atomic<uint64_t>  free_head  {  0  };
+    // objects cut from the leaf for the first time:
+    std::atomic<int>  carved  {  0  };
+    // size_class + 1, 0 - the leaf is not ready yet:
+    std::atomic<int>  class_tag  {  0  };
+    int  obj_size  {  0  };
+    int  obj_cnt  {  0  };
+#if defined(DEF_Small_bitmap)
+    // the bitmap word where the search starts, no free object below it (lowered by ffree):
+    std::atomic<int>  scan_word  {  0  };
+#endif
+  };
+  static constexpr int  Small_Bitmap_Words  {  (Leaf_Size_Bytes  /  16  +  63)  /  64  };
+  static constexpr int  Small_Slack_Offset  {  static_cast<int>(sizeof(SmallLeaf))  +  Small_Bitmap_Words  *  8  };
+  static constexpr int  Small_Data_Offset  {  (Small_Slack_Offset  +  Leaf_Size_Bytes  /  16  +  15)  &  ~15  };
+
+  std::atomic<int>  small_cur[Small_Class_Cnt]  {};  // small leaf id + 1 of each size class, 0 - none
+  std::atomic<int>  small_claimed  {  0  };
+
+  bool  is_small(const void  *ptr)  const
+  {
+    // (offset 0 of a small leaf is SmallLeaf, so it can only be the end of a zero sized usual allocation)
+    const int  leaf_id  =  own_leaf_id(ptr);
+    return  leaf_id  >=  Leaf_Cnt
+        &&  0  !=  (reinterpret_cast<uintptr_t>(ptr)  &  (Leaf_Size_Bytes  -  1));
+  }
+
+  SmallLeaf  * small_leaf(int  small_id)  const
+  {
+    return  reinterpret_cast<SmallLeaf  *>(leaf_base  +  static_cast<std::size_t>(Leaf_Cnt  +  small_id)  *  Leaf_Size_Bytes);
+  }
+
+  static std::atomic<uint64_t>  * small_bitmap(SmallLeaf  *leaf)
+  {
+    return  reinterpret_cast<std::atomic<uint64_t>  *>(reinterpret_cast<char  *>(leaf)  +  sizeof(SmallLeaf));
+  }
+
+  static uint8_t  * small_slack(SmallLeaf  *leaf)
+  {
+    return  reinterpret_cast<uint8_t  *>(leaf)  +  Small_Slack_Offset;
+  }
+
+  static int  small_ctz(uint64_t  bits)
+  {
+#if defined(_MSC_VER)
+    unsigned long  re;
+    _BitScanForward64(&re,  bits);
+    return  static_cast<int>(re);
+#else
+    return  __builtin_ctzll(bits);
+#endif
+  }
+
+  static int  small_popcount(uint64_t  bits)
+  {
+#if defined(_MSC_VER)
+    return  static_cast<int>(__popcnt64(bits));
+#else
+    return  __builtin_popcountll(bits);
+#endif
+  }
+
+  void  * small_malloc(std::size_t  size)
+  {
+    const int  size_class  =  small_class(size);
+    const int  cur  =  small_cur[size_class].load(std::memory_order_acquire)  -  1;
+    if (cur  >=  0)
+    {
+      void  *re  =  small_take(small_leaf(cur),  size);
+      if (re)  {  return  re;  }
+    }
+    // the current leaf is exhausted: find a leaf of the size class with returned objects
+    const int  claimed  =  std::min(small_claimed.load(std::memory_order_acquire),  Small_Leaf_Cnt);
+    for (int  i  =  0;  i  <  claimed;  ++i)
+    {
+      SmallLeaf  *leaf  =  small_leaf(i);
+      if (i  !=  cur  &&  size_class  +  1  ==  leaf->class_tag.load(std::memory_order_acquire))
+      {
+        void  *re  =  small_take(leaf,  size);
+        if (re)
+        {
+          small_cur[size_class].store(i  +  1,  std::memory_order_release);
+          return  re;
+        }
+      }
+    }
+    // or claim a new one:
+    if (claimed  >=  Small_Leaf_Cnt)  {  return  nullptr;  }
+    const int  small_id  =  small_claimed.fetch_add(1,  std::memory_order_acq_rel);
+    if (small_id  >=  Small_Leaf_Cnt)  {  return  nullptr;  }
+    SmallLeaf  *leaf  =  new (small_leaf(small_id)) SmallLeaf();
+    leaf->obj_size  =  small_class_size(size_class);
+    leaf->obj_cnt  =  (Leaf_Size_Bytes  -  Small_Data_Offset)  /  leaf->obj_size;
+    leaf->class_tag.store(size_class  +  1,  std::memory_order_release);
+    small_cur[size_class].store(small_id  +  1,  std::memory_order_release);
+    return  small_take(leaf,  size);
+  }  // small_malloc
+
+  void  * small_take(SmallLeaf  *leaf,  std::size_t  size)
+  {
+    char  *data  =  reinterpret_cast<char  *>(leaf)  +  Small_Data_Offset;
+#if defined(DEF_Small_bitmap)
+    std::atomic<uint64_t>  *bitmap  =  small_bitmap(leaf);
+    const int  words  =  (leaf->obj_cnt  +  63)  /  64;
+    // the bits over obj_cnt in the last word look taken:
+    const uint64_t  last_tail  =  leaf->obj_cnt  %  64  ?  ~uint64_t(0)  <<  (leaf->obj_cnt  %  64)  :  0;
+    const int  first_word  =  std::min(leaf->scan_word.load(std::memory_order_relaxed),  words  -  1);
+    for (int  i  =  0;  i  <  words;  ++i)
+    {
+      const int  w  =  (first_word  +  i)  %  words;
+      const uint64_t  tail  =  words  -  1  ==  w  ?  last_tail  :  0;
+      uint64_t  bits  =  bitmap[w].load(std::memory_order_relaxed)  |  tail;
+      while (~bits)
+      {
+        const uint64_t  bit  =  uint64_t(1)  <<  small_ctz(~bits);
+        // (the other thread may take the bit first: the old word is the fresh view)
+        bits  =  bitmap[w].fetch_or(bit,  std::memory_order_acq_rel)  |  tail;
+        if (!(bits  &  bit))
+        {
+          if (w  !=  first_word)  {  leaf->scan_word.store(w,  std::memory_order_relaxed);  }
+          const int  idx  =  w  *  64  +  small_ctz(bit);
+          small_slack(leaf)[idx]  =  static_cast<uint8_t>(leaf->obj_size  -  size);
+          return  data  +  static_cast<std::size_t>(idx)  *  leaf->obj_size;
+        }
+      }
+    }
+    return  nullptr;
+#else
+    int  idx  =  -1;
+    uint64_t  head  =  leaf->free_head.load(std::memory_order_acquire);
+    while (static_cast<uint32_t>(head))
+    {
+      const int  top  =  static_cast<int>(static_cast<uint32_t>(head))  -  1;
+      // if another thread took the object meanwhile, next is garbage, but the ABA counter fails the CAS:
+      const uint32_t  next  =  *reinterpret_cast<volatile uint32_t  *>(data  +  static_cast<std::size_t>(top)  *  leaf->obj_size);
+      if (leaf->free_head.compare_exchange_weak(head,  (((head  >>  32)  +  1)  <<  32)  |  next,
+            std::memory_order_acq_rel,  std::memory_order_acquire))
+      {
+        idx  =  top;
+        break;
+      }
+    }
+    if (idx  <  0)
+    {
+      if (leaf->carved.load(std::memory_order_relaxed)  >=  leaf->obj_cnt)  {  return  nullptr;  }
+      idx  =  leaf->carved.fetch_add(1,  std::memory_order_relaxed);
+      if (idx  >=  leaf->obj_cnt)  {  return  nullptr;  }
+    }
+    small_slack(leaf)[idx]  =  static_cast<uint8_t>(leaf->obj_size  -  size);
+    small_bitmap(leaf)[idx  /  64].fetch_or(uint64_t(1)  <<  (idx  %  64),  std::memory_order_relaxed);
+    return  data  +  static_cast<std::size_t>(idx)  *  leaf->obj_size;
+#endif
+  }  // small_take
+
+  /**
+   * @brief small_index
+   * @return - object index in its small leaf or -1 if ptr is not the start of an object
+   */
+  int  small_index(const void  *ptr,  SmallLeaf  *&leaf)  const
+  {
+    leaf  =  reinterpret_cast<SmallLeaf  *>(reinterpret_cast<uintptr_t>(ptr)  &  ~static_cast<uintptr_t>(Leaf_Size_Bytes  -  1));
+    if (!leaf->class_tag.load(std::memory_order_acquire))  {  return  -1;  }
+    const long  offset  =  static_cast<const char  *>(ptr)  -  (reinterpret_cast<char  *>(leaf)  +  Small_Data_Offset);
+    if (offset  <  0  ||  0  !=  offset  %  leaf->obj_size)  {  return  -1;  }
+    const int  idx  =  static_cast<int>(offset  /  leaf->obj_size);
+    return  idx  <  leaf->obj_cnt  ?  idx  :  -1;
+  }
+
+  // requested size of a live small object or -1:
+  int  small_live_size(const void  *ptr)  const
+  {
+    SmallLeaf  *leaf;
+    const int  idx  =  small_index(ptr,  leaf);
+    if (idx  <  0
+        ||  !(small_bitmap(leaf)[idx  /  64].load(std::memory_order_relaxed)  &  (uint64_t(1)  <<  (idx  %  64))))
+    {
+      return  -1;
+    }
+    return  leaf->obj_size  -  small_slack(leaf)[idx];
+  }
+
+  bool  small_free(void  *ptr)
+  {
+    SmallLeaf  *leaf;
+    const int  idx  =  small_index(ptr,  leaf);
+    if (idx  <  0)  {  return  false;  }
+    const uint64_t  bit  =  uint64_t(1)  <<  (idx  %  64);
+    // (release: with DEF_Small_bitmap the next fetch_or of the bit takes the object)
+    if (!(small_bitmap(leaf)[idx  /  64].fetch_and(~bit,  std::memory_order_acq_rel)  &  bit))
+    {  // was not allocated
+      return  false;
+    }
+#if defined(DEF_Alloc_trace)
+    fast_mem_pool_tracer.on_ffree(leaf->obj_size  -  small_slack(leaf)[idx],  own_leaf_id(ptr),  FastMemPoolTracePath::Fast);
+#endif
+#if defined(DEF_Small_bitmap)
+    // the cleared bit is the whole free, the search hint goes down to it:
+    const int  word  =  idx  /  64;
+    int  scan_word  =  leaf->scan_word.load(std::memory_order_relaxed);
+    while (word  <  scan_word
+           &&  !leaf->scan_word.compare_exchange_weak(scan_word,  word,  std::memory_order_relaxed))  {  }
+#else
+    uint64_t  head  =  leaf->free_head.load(std::memory_order_relaxed);
+    do {
+      *static_cast<uint32_t  *>(ptr)  =  static_cast<uint32_t>(head);
+    } while (!leaf->free_head.compare_exchange_weak(head,  (((head  >>  32)  +  1)  <<  32)  |  static_cast<uint32_t>(idx  +  1),
+               std::memory_order_acq_rel,  std::memory_order_relaxed));
+#endif
+    return  true;
+  }  // small_free
+#endif
+
+  // true if the leaf is split into buddy blocks (DEF_Buddy_medium): its state does not account the allocations
+  bool  buddy_leaf(int  leaf_id)  const
+  {
+#if defined(DEF_Buddy_medium)
+    return  Buddy_medium  &&  leaf_buddy[leaf_id].load(std::memory_order_acquire);
+#else
+    (void)leaf_id;
+    return  false;
+#endif
+  }
+
+#if defined(DEF_Buddy_medium)
+  /*
+    Buddy leaves: a leaf claimed with claim_free_leaf() (depleted for the bump allocation) is one block
+    of the top order, a block of order k is Buddy_Min_Bytes << k bytes at an offset that is a multiple of its size.
+    fmalloc splits the smallest free block that fits into halves down to the order of the allocation,
+    ffree merges the block with its buddy (index ^ (1 << order)) while the buddy is free and of the same order,
+    a leaf that coalesces whole goes back to the pool. The free blocks of each order are a doubly linked list
+    threaded through the blocks, buddy_tag keeps the order of each block start: O(log n) both ways under buddy_lock.
+    The block starts with the usual AllocHeader, so ffree and check_access see a leaf allocation.
+  */
+  static constexpr int  Buddy_Min_Bytes  {  DEF_Buddy_Min_Bytes  };
+  static constexpr bool  Buddy_medium  {  0  ==  (Leaf_Size_Bytes  &  (Leaf_Size_Bytes  -  1))
+                                          &&  0  ==  (Buddy_Min_Bytes  &  (Buddy_Min_Bytes  -  1))
+                                          &&  Leaf_Size_Bytes  >=  2  *  Buddy_Min_Bytes  };
+  static constexpr int  Buddy_Blocks  {  Buddy_medium  ?  Leaf_Size_Bytes  /  Buddy_Min_Bytes  :  1  };
+  static constexpr int  buddy_log2(int  value)
+  {
+    return  value  >  1  ?  1  +  buddy_log2(value  /  2)  :  0;
+  }
+  // orders 0 (Buddy_Min_Bytes) .. Buddy_Orders - 1 (the whole leaf):
+  static constexpr int  Buddy_Orders  {  buddy_log2(Buddy_Blocks)  +  1  };
+  // buddy_tag: 0 - inside a block, order + 1 - block start, | Buddy_Free_Tag - the block is free
+  static constexpr int  Buddy_Free_Tag  {  0x80  };
+  struct BuddyBlock {
+    BuddyBlock  *prev;
+    BuddyBlock  *next;
+    int  leaf_id;
+  };
+  static_assert(!Buddy_medium  ||  Buddy_Min_Bytes  >=  static_cast<int>(sizeof(BuddyBlock)),
+    "FastMemPool: DEF_Buddy_Min_Bytes is less than the link of a free block");
+
+  std::atomic<bool>  leaf_buddy[Leaf_Cnt]  {};
+  BuddyBlock  *buddy_free[Buddy_Orders]  {};
+  uint8_t  buddy_tag[Buddy_medium  ?  Leaf_Cnt  :  1][Buddy_Blocks]  {};
+  std::atomic<bool>  buddy_lock  {  false  };
+
+  void  buddy_lock_take()
+  {
+    while (buddy_lock.exchange(true,  std::memory_order_acquire))  {  std::this_thread::yield();  }
+  }
+
+  static int  buddy_order(int  real_size)
+  {
+    int  order  =  0;
+    while ((Buddy_Min_Bytes  <<  order)  <  real_size)  {  ++order;  }
+    return  order;
+  }
+
+  BuddyBlock  * buddy_block(int  leaf_id,  int  idx)  const
+  {
+    return  reinterpret_cast<BuddyBlock  *>(leaf_buf[leaf_id]  +  static_cast<std::size_t>(idx)  *  Buddy_Min_Bytes);
+  }
+
+  // (under buddy_lock)
+  void  buddy_push(int  leaf_id,  int  idx,  int  order)
+  {
+    BuddyBlock  *block  =  buddy_block(leaf_id,  idx);
+    block->prev  =  nullptr;
+    block->next  =  buddy_free[order];
+    block->leaf_id  =  leaf_id;
+    if (block->next)  {  block->next->prev  =  block;  }
+    buddy_free[order]  =  block;
+    buddy_tag[leaf_id][idx]  =  static_cast<uint8_t>(Buddy_Free_Tag  |  (order  +  1));
+  }
+
+  void  buddy_unlink(BuddyBlock  *block,  int  order)
+  {
+    if (block->prev)  {  block->prev->next  =  block->next;  }  else  {  buddy_free[order]  =  block->next;  }
+    if (block->next)  {  block->next->prev  =  block->prev;  }
+  }
+
+  /**
+   * @brief buddy_alloc - the smallest free block that fits is split down to the order of real_size,
+   * a fully available leaf of the pool becomes a buddy leaf when no block fits
+   * @param real_size  -  allocation size with AllocHeader
+   * @param leaf_id  -  [out] leaf of the block
+   * @param grown  -  nullptr or [out] the bytes of the block over real_size (fmalloc_at_least)
+   * @return - the block (AllocHeader is not filled yet) or nullptr if no leaf is fully available
+   */
+  char  * buddy_alloc(int  real_size,  int  &leaf_id,  int  *grown)
+  {
+    const int  order  =  buddy_order(real_size);
+    for (;;)
+    {
+      buddy_lock_take();
+      int  k  =  order;
+      while (k  <  Buddy_Orders  &&  !buddy_free[k])  {  ++k;  }
+      if (k  <  Buddy_Orders)
+      {
+        BuddyBlock  *block  =  buddy_free[k];
+        buddy_unlink(block,  k);
+        leaf_id  =  block->leaf_id;
+        const int  idx  =  static_cast<int>((reinterpret_cast<char  *>(block)  -  leaf_buf[leaf_id])  /  Buddy_Min_Bytes);
+        // the upper halves stay free:
+        while (k  >  order)
+        {
+          --k;
+          buddy_push(leaf_id,  idx  +  (1  <<  k),  k);
+        }
+        buddy_tag[leaf_id][idx]  =  static_cast<uint8_t>(order  +  1);
+        buddy_lock.store(false,  std::memory_order_release);
+        if (grown)  {  *grown  =  (Buddy_Min_Bytes  <<  order)  -  real_size;  }
+        return  reinterpret_cast<char  *>(block);
+      }
+      buddy_lock.store(false,  std::memory_order_release);
+      // (out of the lock: the claim may provision a leaf)
+      const int  new_leaf  =  claim_free_leaf();
+      if (new_leaf  <  0)  {  return  nullptr;  }
+      leaf_buddy[new_leaf].store(true,  std::memory_order_release);
+      buddy_lock_take();
+      buddy_push(new_leaf,  0,  Buddy_Orders  -  1);
+      buddy_lock.store(false,  std::memory_order_release);
+    }
+  }  // buddy_alloc
+
+  /**
+   * @brief buddy_release - the block of the allocation is merged with its free buddies
+   * @param at  -  AllocHeader of the allocation (fmalloc_aligned moves it up inside the block)
+   * @param leaf_id  -  buddy leaf
+   * @return - true if the leaf coalesced whole and went back to the pool
+   */
+  bool  buddy_release(char  *at,  int  leaf_id)
+  {
+    int  idx  =  static_cast<int>((at  -  leaf_buf[leaf_id])  /  Buddy_Min_Bytes);
+    buddy_lock_take();
+    while (idx  >  0  &&  !buddy_tag[leaf_id][idx])  {  --idx;  }
+    int  order  =  buddy_tag[leaf_id][idx]  -  1;
+    while (order  <  Buddy_Orders  -  1)
+    {
+      const int  buddy  =  idx  ^  (1  <<  order);
+      if (buddy_tag[leaf_id][buddy]  !=  (Buddy_Free_Tag  |  (order  +  1)))  {  break;  }
+      buddy_unlink(buddy_block(leaf_id,  buddy),  order);
+      buddy_tag[leaf_id][buddy]  =  0;
+      buddy_tag[leaf_id][idx]  =  0;
+      idx  &=  ~(1  <<  order);
+      ++order;
+    }
+    if (Buddy_Orders  -  1  ==  order)
+    {  // the whole leaf is free, it goes back to the bump allocation:
+      buddy_tag[leaf_id][0]  =  0;
+      leaf_buddy[leaf_id].store(false,  std::memory_order_relaxed);
+      buddy_lock.store(false,  std::memory_order_release);
+      leaf_array[leaf_id].state.store(leaf_state(Leaf_Size_Bytes,  0),  std::memory_order_release);
+      return  true;
+    }
+    buddy_push(leaf_id,  idx,  order);
+    buddy_lock.store(false,  std::memory_order_release);
+    return  false;
+  }  // buddy_release
+#endif
+
+#if defined(DEF_Contention_profile)
+  // Scan length buckets: 0, 1, 2-3, 4-7, 8-15, 16+, OS (all leaves skipped)
+  static constexpr int  Contention_Scan_Buckets  {  7  };
+  static constexpr int  Contention_Columns  {  Contention_Scan_Buckets  +  3  };
+  struct alignas(DEF_Cache_line_Bytes) LeafContention {
+    std::atomic<uint64_t>  scans[Contention_Scan_Buckets]  {};
+    std::atomic<uint64_t>  reserve_retries  {  0  };
+    std::atomic<uint64_t>  reset_cas_fails  {  0  };
+    std::atomic<uint64_t>  cur_leaf_stores  {  0  };
+  };
+  LeafContention  contention[Leaf_Cnt];
+
+  void  contention_on_scan(int  start_leaf,  int  skipped)
+  {
+    int  bucket  =  Contention_Scan_Buckets  -  1;
+    if (skipped  <  Leaf_Cnt)
+    {
+      bucket  =  0;
+      while (skipped  >  0  &&  bucket  <  Contention_Scan_Buckets  -  2)
+      {
+        ++bucket;
+        skipped  >>=  1;
+      }
+    }
+    contention[start_leaf].scans[bucket].fetch_add(1,  std::memory_order_relaxed);
+  }
+#endif
+
 #if defined(Debug)
   struct AllocInfo {
     std::string  who;  // who performed the operation: file, code line number, in which method
@@ -541,11 +3098,29 @@ private:
 #if defined(Debug)
 #define FMALLOC(iFastMemPool, allocation_size) \
    (iFastMemPool)->fmallocd (__FILE__, __LINE__, __FUNCTION__, allocation_size)
+#elif defined(DEF_Alloc_site)
+#define FMALLOC(iFastMemPool, allocation_size) \
+   (iFastMemPool)->fmalloc_site (allocation_size, FMALLOC_SITE_ID())
 #else
 #define FMALLOC(iFastMemPool, allocation_size) \
    (iFastMemPool)->fmalloc (allocation_size)
 #endif
 
+/**
+   * @brief FMALLOC_HINT  -  FMALLOC in the leaf group of the expected lifetime
+   * @param hint  -  FastMemPoolLifetimeHint (used if defined (DEF_Lifetime_groups))
+*/
+#if defined(Debug)
+#define FMALLOC_HINT(iFastMemPool, allocation_size, hint) \
+   (iFastMemPool)->fmallocd (__FILE__, __LINE__, __FUNCTION__, allocation_size, hint)
+#elif defined(DEF_Alloc_site)
+#define FMALLOC_HINT(iFastMemPool, allocation_size, hint) \
+   (iFastMemPool)->fmalloc_site (allocation_size, FMALLOC_SITE_ID(), hint)
+#else
+#define FMALLOC_HINT(iFastMemPool, allocation_size, hint) \
+   (iFastMemPool)->fmalloc (allocation_size, hint)
+#endif
+
 /**
  * @brief FFREE  -  function to release allocation instead of "free"
  * @param iFastMemPool  - an instance of FastMemPool in which we allocate
@@ -584,7 +3159,7 @@ struct FastMemPoolNull
 
 /**
  * FastMemPoolAllocator
- * == std::allocator<T> template
+ * Allocator (C++17 Allocator requirements) over FastMemPool
  * Default works with SingleTone FastMemPool<>::instance()
  * FastMemPool can be injected as template method or allocation strategy:
 
@@ -595,53 +3170,79 @@ struct FastMemPoolNull
   using MyAllocatorType = FastMemPool<333, 33>;
   MyAllocatorType  fastMemPool;  // instance of
   FastMemPoolAllocator<std::string, MyAllocatorType > myAllocator(&fastMemPool);
+
+ The pool pointer is taken once in the constructor and is kept by rebind (the nodes of
+ std::unordered_map, std::map.. go to the same pool), allocators are equal if their pools are,
+ the containers carry the allocator (and so the pool) on copy/move assignment and swap.
+ The lifetime hint (DEF_Lifetime_groups) is kept by rebind too:
+  std::vector<Frame, FastMemPoolAllocator<Frame>>  frames(FastMemPoolAllocator<Frame>(&pool,  FastMemPoolLifetimeHint::Short));
  */
 template<class T, class FAllocator = FastMemPoolNull >
-struct FastMemPoolAllocator : public std::allocator<T>  {
+struct FastMemPoolAllocator  {
   typedef T value_type;
-  using  MyAllocatorType = FAllocator;
+  typedef T * pointer;
+  typedef const T * const_pointer;
+  typedef T & reference;
+  typedef const T & const_reference;
+  typedef std::size_t size_type;
+  typedef std::ptrdiff_t difference_type;
+  using  MyAllocatorType = typename std::conditional<std::is_same<FAllocator,  FastMemPoolNull>::value,
+    FastMemPool<>,  FAllocator>::type;
+  using  propagate_on_container_copy_assignment = std::true_type;
+  using  propagate_on_container_move_assignment = std::true_type;
+  using  propagate_on_container_swap = std::true_type;
+  using  is_always_equal = std::false_type;
+  template<class U> struct rebind {  typedef FastMemPoolAllocator<U,  FAllocator> other;  };
+#if defined(__cpp_lib_allocate_at_least)
+  using  allocation_result = std::allocation_result<T *,  std::size_t>;
+#else
+  struct allocation_result {
+    T  *ptr;
+    std::size_t  count;
+  };
+#endif
+
   MyAllocatorType * p_allocator  {  nullptr  };
-  FastMemPoolAllocator() = default;
-  FastMemPoolAllocator(MyAllocatorType  *in_allocator) : p_allocator(in_allocator) { }
-  template <class U> constexpr FastMemPoolAllocator (const FastMemPoolAllocator  <U>&)
-  noexcept {}
+  FastMemPoolLifetimeHint  hint  {  FastMemPoolLifetimeHint::Medium  };
+  FastMemPoolAllocator()  :  p_allocator(MyAllocatorType::instance())  {  }
+  FastMemPoolAllocator(MyAllocatorType  *in_allocator,  FastMemPoolLifetimeHint  in_hint  =  FastMemPoolLifetimeHint::Medium)
+    :  p_allocator(in_allocator  ?  in_allocator  :  MyAllocatorType::instance()),  hint(in_hint)  {  }
+  template <class U> constexpr FastMemPoolAllocator (const FastMemPoolAllocator  <U,  FAllocator>  &other)
+  noexcept  :  p_allocator(other.p_allocator),  hint(other.hint)  {  }
 
   T* allocate(std::size_t n) {
     if (n > std::numeric_limits<std::size_t>::max() / sizeof (T))
       throw std::bad_alloc();
-    if constexpr(std::is_same<FAllocator, FastMemPoolNull>::value)
-    {
-      if (auto p = static_cast<T *>(FMALLOC(FastMemPool<>::instance(), (n * sizeof (T)))))
-        return p;
-    }  else {
-      if (p_allocator) {
-        if (auto p = static_cast<T *>(FMALLOC(p_allocator, (n * sizeof (T)))))
-          return p;
-      } else {
-        if (auto p = static_cast<T *>(FMALLOC(FAllocator::instance(), (n * sizeof (T)))))
-          return p;
-      }
-
-    }
-
+    if (auto p = static_cast<T *>(FMALLOC_HINT(p_allocator, (n * sizeof (T)), hint)))
+      return p;
     throw  std::bad_alloc();
   } // alloc
 
+  // C++23 allocate_at_least: the pool may give more elements (see FastMemPool::fmalloc_at_least)
+  allocation_result  allocate_at_least(std::size_t n) {
+    if (n > std::numeric_limits<std::size_t>::max() / sizeof (T))
+      throw std::bad_alloc();
+#if defined(Debug)
+    return  {  allocate(n),  n  };
+#else
+    std::size_t  actual_size  =  0;
+    if (auto p = static_cast<T *>(p_allocator->fmalloc_at_least(n * sizeof (T),  &actual_size,  hint)))
+      return  {  p,  actual_size / sizeof (T)  };
+    throw  std::bad_alloc();
+#endif
+  }
+
   void deallocate(T* p,  std::size_t) noexcept
   {
-    if constexpr(std::is_same<FAllocator, FastMemPoolNull>::value)
-    {
-      FFREE(FastMemPool<>::instance(),  p);
-    }  else {
-      if (p_allocator) {
-        FFREE(p_allocator,  p);
-      } else {
-        FFREE(FAllocator::instance(),  p);
-      }
-    }
+    FFREE(p_allocator,  p);
     return;
   }
 
+  size_type  max_size()  const  noexcept
+  {
+    return  std::numeric_limits<std::size_t>::max() / sizeof (T);
+  }
+
   template<typename _Up, typename... _Args>
   void
   construct(_Up* __p, _Args&&... __args)
@@ -651,9 +3252,460 @@ struct FastMemPoolAllocator : public std::allocator<T>  {
   void
   destroy(_Up* __p) { __p->~_Up(); }
 };
-template <class T, class U>
-bool operator==(const FastMemPoolAllocator<T>&, const FastMemPoolAllocator<U>&) { return true; }
-template<class T, class U>
-bool operator!=(const FastMemPoolAllocator<T>&, const FastMemPoolAllocator<U>&) { return false; }
+template <class T, class U, class FAllocator>
+bool operator==(const FastMemPoolAllocator<T, FAllocator>& lh, const FastMemPoolAllocator<U, FAllocator>& rh)
+{ return lh.p_allocator == rh.p_allocator; }
+template<class T, class U, class FAllocator>
+bool operator!=(const FastMemPoolAllocator<T, FAllocator>& lh, const FastMemPoolAllocator<U, FAllocator>& rh)
+{ return lh.p_allocator != rh.p_allocator; }
+
+/**
+ * FastMemPoolNodeCache
+ * Free list of the single nodes of FastMemPoolNodeAllocator (shared by the copies and the rebinds
+ * of one allocator): the nodes are cut from chunks of Chunk_Nodes taken with one fmalloc, so a node
+ * has no AllocHeader, a freed node goes to the lock-free list and is reused without the leaf CAS.
+ * The node stride is fixed by the first single node allocation, the chunks go back to the pool
+ * when the last allocator copy is destroyed.
+ */
+template<class Pool>
+class FastMemPoolNodeCache
+{
+public:
+  static constexpr int  Chunk_Nodes  {  64  };
+  static constexpr std::size_t  Node_Align  {  16  };
+
+  // the cache itself lives in the pool:
+  static FastMemPoolNodeCache  * create(Pool  *pool)
+  {
+    void  *place  =  FMALLOC(pool,  sizeof(FastMemPoolNodeCache));
+    if (!place)  {  throw  std::bad_alloc();  }
+    return  new (place) FastMemPoolNodeCache(pool);
+  }
+
+  void  add_ref()  noexcept
+  {
+    refs.fetch_add(1,  std::memory_order_relaxed);
+  }
+
+  void  release()  noexcept
+  {
+    if (1  !=  refs.fetch_sub(1,  std::memory_order_acq_rel))  {  return;  }
+    Pool  *owner  =  pool;
+    void  *chunk  =  chunks.load(std::memory_order_acquire);
+    const std::size_t  bytes  =  chunk_bytes(stride.load(std::memory_order_relaxed));
+    while (chunk)
+    {
+      void  *next  =  *static_cast<void  **>(chunk);
+      free_block(owner,  chunk,  bytes);
+      chunk  =  next;
+    }
+    this->~FastMemPoolNodeCache();
+    free_block(owner,  this,  sizeof(FastMemPoolNodeCache));
+  }
+
+  // node stride of U: 0 - U goes to the large path
+  template<class U>
+  static constexpr std::size_t  node_stride()
+  {
+    return  alignof(U)  >  Node_Align  ?  0
+      :  (std::max(sizeof(U),  sizeof(void  *))  +  std::max(alignof(U),  alignof(void  *))  -  1)
+         &  ~(std::max(alignof(U),  alignof(void  *))  -  1);
+  }
+
+  // true if the single U nodes are served by the cache (the first one fixes the stride):
+  template<class U>
+  bool  takes(bool  allocating)  noexcept
+  {
+    constexpr std::size_t  u_stride  =  node_stride<U>();
+    if (0  ==  u_stride)  {  return  false;  }
+    std::size_t  fixed  =  stride.load(std::memory_order_acquire);
+    if (0  ==  fixed  &&  allocating
+        &&  !stride.compare_exchange_strong(fixed,  u_stride,  std::memory_order_acq_rel))
+    {  // (fixed is the other thread's stride)
+      return  fixed  ==  u_stride;
+    }
+    return  0  ==  fixed  ?  allocating  :  fixed  ==  u_stride;
+  }
+
+  void  * pop()
+  {
+    void  *re  =  try_pop();
+    return  re  ?  re  :  refill();
+  }
+
+  // a node of the list, nullptr if the list is empty (no new chunk):
+  void  * try_pop()  noexcept
+  {
+    uint64_t  top  =  head.load(std::memory_order_acquire);
+    while (node_ptr(top))
+    {  // (a chunk is never freed before the cache, reading a node taken meanwhile is safe, the tag fails the CAS)
+      void  *next  =  *static_cast<void  **>(node_ptr(top));
+      if (head.compare_exchange_weak(top,  pack(next,  top),  std::memory_order_acq_rel,  std::memory_order_acquire))
+      {
+        return  node_ptr(top);
+      }
+    }
+    return  nullptr;
+  }
+
+  void  push(void  *node)  noexcept
+  {
+    push_chain(node,  node);
+  }
+
+  Pool  * get_pool()  const  noexcept  {  return  pool;  }
+
+private:
+  explicit FastMemPoolNodeCache(Pool  *in_pool)  noexcept  :  pool(in_pool)  {  }
+
+  // the list head: node pointer (low 48 bits) + ABA tag (high 16 bits)
+  static constexpr int  Tag_Shift  {  48  };
+  static void  * node_ptr(uint64_t  top)
+  {
+    return  reinterpret_cast<void  *>(static_cast<uintptr_t>(top  &  ((uint64_t(1)  <<  Tag_Shift)  -  1)));
+  }
+
+  static uint64_t  pack(void  *node,  uint64_t  prev)
+  {
+    return  static_cast<uint64_t>(reinterpret_cast<uintptr_t>(node))
+        |  (((prev  >>  Tag_Shift)  +  1)  <<  Tag_Shift);
+  }
+
+  static constexpr std::size_t  chunk_bytes(std::size_t  node_stride)
+  {
+    return  sizeof(void  *)  +  Node_Align  -  1  +  Chunk_Nodes  *  node_stride;
+  }
+
+  static void  free_block(Pool  *owner,  void  *ptr,  std::size_t  bytes)
+  {
+#if defined(Debug)
+    (void)bytes;
+    FFREE(owner,  ptr);
+#else
+    owner->ffree(ptr,  bytes);
+#endif
+  }
+
+  void  push_chain(void  *first,  void  *last)  noexcept
+  {
+    uint64_t  top  =  head.load(std::memory_order_relaxed);
+    do  {
+      *static_cast<void  **>(last)  =  node_ptr(top);
+    }  while (!head.compare_exchange_weak(top,  pack(first,  top),  std::memory_order_acq_rel,  std::memory_order_relaxed));
+  }
+
+  // new chunk: the first node is returned, the others go to the list
+  void  * refill()
+  {
+    const std::size_t  node_stride  =  stride.load(std::memory_order_acquire);
+    char  *chunk  =  static_cast<char  *>(FMALLOC(pool,  chunk_bytes(node_stride)));
+    if (!chunk)  {  return  nullptr;  }
+    void  *top  =  chunks.load(std::memory_order_relaxed);
+    do  {
+      *reinterpret_cast<void  **>(chunk)  =  top;
+    }  while (!chunks.compare_exchange_weak(top,  chunk,  std::memory_order_acq_rel,  std::memory_order_relaxed));
+    char  *first  =  reinterpret_cast<char  *>((reinterpret_cast<uintptr_t>(chunk)  +  sizeof(void  *)  +  Node_Align  -  1)
+                                             &  ~(Node_Align  -  1));
+    for (int  i  =  1;  i  <  Chunk_Nodes  -  1;  ++i)
+    {
+      *reinterpret_cast<void  **>(first  +  i  *  node_stride)  =  first  +  (i  +  1)  *  node_stride;
+    }
+    push_chain(first  +  node_stride,  first  +  (Chunk_Nodes  -  1)  *  node_stride);
+    return  first;
+  }
+
+  std::atomic<uint64_t>  head  {  0  };
+  std::atomic<void  *>  chunks  {  nullptr  };
+  std::atomic<std::size_t>  stride  {  0  };
+  std::atomic<int>  refs  {  1  };
+  Pool  *pool;
+};
+
+/**
+ * FastMemPoolNodeAllocator
+ * Allocator for the node containers (std::map, std::set, std::unordered_map, std::list..):
+ * allocate(1) of the node type is served header free by the FastMemPoolNodeCache of the allocator,
+ * the arrays (buckets, vector storage) go to the large path: fmalloc and the sized ffree.
+ * The copies and the rebinds share the cache (and compare equal), a copy constructed container
+ * gets a new cache on the same pool. The erased nodes stay in the cache until the container dies.
+
+ using  TNodeAllocator = FastMemPoolNodeAllocator<std::pair<const int,  int>,  FastMemPool<1048576, 64>>;
+ std::unordered_map<int,  int, std::hash<int>, std::equal_to<int>, TNodeAllocator>  umap(16, std::hash<int>(), std::equal_to<int>(),  TNodeAllocator(&pool));
+ */
+template<class T, class FAllocator = FastMemPoolNull >
+struct FastMemPoolNodeAllocator  {
+  typedef T value_type;
+  typedef std::size_t size_type;
+  typedef std::ptrdiff_t difference_type;
+  using  MyAllocatorType = typename std::conditional<std::is_same<FAllocator,  FastMemPoolNull>::value,
+    FastMemPool<>,  FAllocator>::type;
+  using  NodeCache = FastMemPoolNodeCache<MyAllocatorType>;
+  using  propagate_on_container_copy_assignment = std::true_type;
+  using  propagate_on_container_move_assignment = std::true_type;
+  using  propagate_on_container_swap = std::true_type;
+  using  is_always_equal = std::false_type;
+  template<class U> struct rebind {  typedef FastMemPoolNodeAllocator<U,  FAllocator> other;  };
+
+  NodeCache  *cache;
+  FastMemPoolNodeAllocator()  :  cache(NodeCache::create(MyAllocatorType::instance()))  {  }
+  FastMemPoolNodeAllocator(MyAllocatorType  *in_allocator)
+    :  cache(NodeCache::create(in_allocator  ?  in_allocator  :  MyAllocatorType::instance()))  {  }
+  FastMemPoolNodeAllocator(const FastMemPoolNodeAllocator  &other)  noexcept  :  cache(other.cache)
+  {
+    cache->add_ref();
+  }
+  template <class U> FastMemPoolNodeAllocator(const FastMemPoolNodeAllocator<U,  FAllocator>  &other)  noexcept
+    :  cache(other.cache)
+  {
+    cache->add_ref();
+  }
+  FastMemPoolNodeAllocator  & operator=(const FastMemPoolNodeAllocator  &other)  noexcept
+  {
+    other.cache->add_ref();
+    cache->release();
+    cache  =  other.cache;
+    return  *this;
+  }
+  ~FastMemPoolNodeAllocator()
+  {
+    cache->release();
+  }
+
+  // a copy of the container has its own nodes:
+  FastMemPoolNodeAllocator  select_on_container_copy_construction()  const
+  {
+    return  FastMemPoolNodeAllocator(cache->get_pool());
+  }
+
+  T* allocate(std::size_t n) {
+    if (1  ==  n  &&  cache->template takes<T>(true))
+    {
+      if (void  *p  =  cache->pop())  return static_cast<T *>(p);
+      throw  std::bad_alloc();
+    }
+    if (n > std::numeric_limits<std::size_t>::max() / sizeof (T))
+      throw std::bad_alloc();
+    if (auto p = static_cast<T *>(FMALLOC(cache->get_pool(), (n * sizeof (T)))))
+      return p;
+    throw  std::bad_alloc();
+  } // alloc
+
+  void deallocate(T* p,  std::size_t n) noexcept
+  {
+    if (1  ==  n  &&  cache->template takes<T>(false))
+    {
+      cache->push(p);
+      return;
+    }
+#if defined(Debug)
+    FFREE(cache->get_pool(),  p);
+#else
+    cache->get_pool()->ffree(p,  n * sizeof (T));
+#endif
+    return;
+  }
+};
+template <class T, class U, class FAllocator>
+bool operator==(const FastMemPoolNodeAllocator<T, FAllocator>& lh, const FastMemPoolNodeAllocator<U, FAllocator>& rh)
+{ return lh.cache == rh.cache; }
+template<class T, class U, class FAllocator>
+bool operator!=(const FastMemPoolNodeAllocator<T, FAllocator>& lh, const FastMemPoolNodeAllocator<U, FAllocator>& rh)
+{ return lh.cache != rh.cache; }
+
+/**
+ * FastMemPoolObject
+ * CRTP mixin: class specific operator new/delete of Derived (and of its derived classes)
+ * go to a FastMemPool, the call sites stay "new Frame", std::make_unique<Frame>():
+
+ struct Frame : public FastMemPoolObject<Frame, FastMemPool<1048576, 64>> {
+   ...
+ };
+ Frame::set_fast_mem_pool(&frames_pool);  // optional, default Pool::instance()
+
+ The size is rounded to __STDCPP_DEFAULT_NEW_ALIGNMENT__ and goes to fmalloc_aligned (at least that
+ alignment, as the global operator new): the cuts of the rounded sizes keep the leaf aligned, so it is
+ the plain fmalloc unless other allocations of the pool have odd sizes.
+ Only the sized operator delete is declared, so the compiler gives the object size and
+ ffree does not read it from the header (delete through a base needs a virtual destructor).
+ fmalloc errors (range_error of Raise_Exeptions, nullptr) are std::bad_alloc as for the global new.
+ */
+template<class Derived, class Pool = FastMemPool<> >
+class FastMemPoolObject
+{
+public:
+  // before the first new, the objects already allocated must be deleted into their own pool:
+  static void  set_fast_mem_pool(Pool  *pool)  noexcept
+  {
+    mem_pool.store(pool,  std::memory_order_release);
+  }
+
+  static Pool  * get_fast_mem_pool()  noexcept
+  {
+    Pool  *pool  =  mem_pool.load(std::memory_order_acquire);
+    return  pool  ?  pool  :  Pool::instance();
+  }
+
+  static void  * operator new(std::size_t  size)
+  {
+    return  operator new(size,  Default_Alignment);
+  }
+
+  static void  * operator new[](std::size_t  size)
+  {
+    return  operator new(size);
+  }
+
+  static void  * operator new(std::size_t  size,  const std::nothrow_t  &)  noexcept
+  {
+    try  {
+      return  get_fast_mem_pool()->fmalloc_aligned(rounded(size),  __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+    }  catch (...)  {
+      return  nullptr;
+    }
+  }
+
+  static void  * operator new[](std::size_t  size,  const std::nothrow_t  &nt)  noexcept
+  {
+    return  operator new(size,  nt);
+  }
+
+  static void  * operator new(std::size_t  size,  std::align_val_t  alignment)
+  {
+    void  *re  =  nullptr;
+    try  {
+      re  =  get_fast_mem_pool()->fmalloc_aligned(rounded(size),  static_cast<std::size_t>(alignment));
+    }  catch (const std::range_error  &)  {
+    }
+    if (!re)  {  throw  std::bad_alloc();  }
+    return  re;
+  }
+
+  static void  * operator new[](std::size_t  size,  std::align_val_t  alignment)
+  {
+    return  operator new(size,  alignment);
+  }
+
+  // placement new stays visible:
+  static void  * operator new(std::size_t,  void  *place)  noexcept
+  {
+    return  place;
+  }
+
+  static void  operator delete(void  *ptr,  std::size_t  size)  noexcept
+  {
+    operator delete(ptr,  size,  Default_Alignment);
+  }
+
+  static void  operator delete[](void  *ptr,  std::size_t  size)  noexcept
+  {
+    operator delete(ptr,  size);
+  }
+
+  // (fmalloc_aligned keeps the rounded size in the header, the OS malloc fallback too)
+  static void  operator delete(void  *ptr,  std::size_t  size,  std::align_val_t)  noexcept
+  {
+    if (ptr)  {  get_fast_mem_pool()->ffree(ptr,  rounded(size));  }
+  }
+
+  static void  operator delete[](void  *ptr,  std::size_t  size,  std::align_val_t  alignment)  noexcept
+  {
+    operator delete(ptr,  size,  alignment);
+  }
+
+  // a constructor that throws after the nothrow new:
+  static void  operator delete(void  *ptr,  const std::nothrow_t  &)  noexcept
+  {
+    if (ptr)  {  get_fast_mem_pool()->ffree(ptr);  }
+  }
+
+  static void  operator delete[](void  *ptr,  const std::nothrow_t  &nt)  noexcept
+  {
+    operator delete(ptr,  nt);
+  }
+
+  static void  operator delete(void  *,  void  *)  noexcept
+  {
+  }
+
+private:
+  static constexpr std::align_val_t  Default_Alignment  {  __STDCPP_DEFAULT_NEW_ALIGNMENT__  };
+
+  static constexpr std::size_t  rounded(std::size_t  size)
+  {
+    return  (size  +  __STDCPP_DEFAULT_NEW_ALIGNMENT__  -  1)  &  ~(__STDCPP_DEFAULT_NEW_ALIGNMENT__  -  1);
+  }
+
+  static inline std::atomic<Pool  *>  mem_pool  {  nullptr  };
+};
+
+#if defined(FastMemPool_PMR)
+/**
+ * FastMemPoolResource
+ * std::pmr::memory_resource over any FastMemPool: the pmr containers take the pool at runtime
+ * (one container type for all the pools, no allocator template per pool):
+
+ FastMemPool<1048576, 64>  msg_pool;
+ FastMemPoolResource<FastMemPool<1048576, 64>>  msg_resource(&msg_pool);
+ std::pmr::unordered_map<int, std::pmr::string>  umap(&msg_resource);
+
+ Every size is rounded to alignof(std::max_align_t), the byte buffers of the strings too: the cuts of
+ the rounded sizes keep the leaf aligned, so fmalloc_aligned is the plain fmalloc unless other allocations
+ of the pool have odd sizes (only an over-aligned allocation is padded). deallocate gives the same size,
+ ffree does not read it from the header and there is no owns() scan: the OS malloc fallback is the pool's too.
+ The upstream resource serves only a pool without OS malloc whose leaves are full.
+ */
+template<class Pool = FastMemPool<> >
+class FastMemPoolResource : public std::pmr::memory_resource
+{
+public:
+  explicit FastMemPoolResource(Pool  *in_pool  =  Pool::instance(),
+                               std::pmr::memory_resource  *in_upstream  =  std::pmr::new_delete_resource())  noexcept
+    : pool(in_pool),  upstream(in_upstream)  {  }
+
+  FastMemPoolResource(const FastMemPoolResource  &)  =  default;
+
+  Pool  * get_fast_mem_pool()  const  noexcept  {  return  pool;  }
+
+  std::pmr::memory_resource  * upstream_resource()  const  noexcept  {  return  upstream;  }
+
+protected:
+  void  * do_allocate(std::size_t  bytes,  std::size_t  alignment)  override
+  {
+    void  *re  =  nullptr;
+    try  {
+      re  =  pool->fmalloc_aligned(pool_size(bytes),  alignment);
+    }  catch (const std::range_error  &)  {  // (the leaves are full and the pool has no OS malloc)
+    }
+    return  re  ?  re  :  upstream->allocate(bytes,  alignment);
+  }
+
+  void  do_deallocate(void  *ptr,  std::size_t  bytes,  std::size_t  alignment)  override
+  {
+    if (Pool::get_do_os_malloc()  ||  pool->owns(ptr))
+    {
+      pool->ffree(ptr,  pool_size(bytes));
+    }  else  {
+      upstream->deallocate(ptr,  bytes,  alignment);
+    }
+  }
+
+  // the resources over the same pool free each other's allocations:
+  bool  do_is_equal(const std::pmr::memory_resource  &other)  const  noexcept  override
+  {
+    if (this  ==  &other)  {  return  true;  }
+    const FastMemPoolResource  *rh  =  dynamic_cast<const FastMemPoolResource  *>(&other);
+    return  rh  &&  rh->pool  ==  pool  &&  rh->upstream->is_equal(*upstream);
+  }
+
+private:
+  static constexpr std::size_t  pool_size(std::size_t  bytes)
+  {
+    return  (bytes  +  alignof(std::max_align_t)  -  1)  &  ~(alignof(std::max_align_t)  -  1);
+  }
+
+  Pool  *pool;
+  std::pmr::memory_resource  *upstream;
+};
+#endif
 
 #endif //FastMemPool_H
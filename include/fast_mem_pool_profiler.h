@@ -0,0 +1,267 @@
+/*
+ * This is the source code of SpecNet project
+ * It is licensed under MIT License.
+ *
+ * Copyright (c) Dmitriy Bondarenko
+ * feel free to contact me: specnet.messenger@gmail.com
+ */
+
+#ifndef FastMemPoolProfiler_H
+#define FastMemPoolProfiler_H
+
+#include <atomic>
+#include <stdint.h>
+#include <math.h>
+#include <string>
+#include <map>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#if defined(__linux__) || defined(__APPLE__)
+#include <execinfo.h>
+#endif
+
+// Average bytes between two samples:
+#ifndef DEF_Heap_profile_Rate
+#define DEF_Heap_profile_Rate  524288
+#endif
+// Max sampled allocations alive at the same time (power of 2):
+#ifndef DEF_Heap_profile_Slots
+#define DEF_Heap_profile_Slots  8192
+#endif
+// Slots probed from the hash of a pointer (a sample that finds no free one among them is lost),
+// the freed samples leave tombstones, so ffree of an unsampled pointer stops here at the latest:
+#ifndef DEF_Heap_profile_Probe
+#define DEF_Heap_profile_Probe  32
+#endif
+#ifndef DEF_Heap_profile_Depth
+#define DEF_Heap_profile_Depth  24
+#endif
+#if defined(_MSC_VER)
+#define FMP_NOINLINE  __declspec(noinline)
+#else
+#define FMP_NOINLINE  __attribute__((noinline))
+#endif
+
+/*
+ * FastMemPoolProfiler
+ * Statistical heap profiler for FastMemPool (compiled in if defined(DEF_Heap_profile)).
+ * About one allocation per DEF_Heap_profile_Rate bytes is sampled: each thread
+ * counts down allocated bytes and only when the countdown is over
+ * the stack is captured with backtrace() and stored into a lock-free
+ * open addressing table keyed by the allocation pointer.
+ * ffree removes sampled pointers, so the table is the live heap.
+ * heap_profile() gives the text in the legacy gperftools heap profile format
+ * ("heap profile: ... @ heap_v2/rate") that pprof can read:
+ *   pprof --text ./my_exe heap.prof
+ */
+class FastMemPoolProfiler
+{
+public:
+  constexpr FastMemPoolProfiler()  {}
+
+  /**
+   * @brief on_alloc - hot path, called by fmalloc for each allocation
+   * @param ptr  -  allocation ptr
+   * @param size  -  allocation size
+   */
+  void  on_alloc(void  *ptr,  std::size_t  size)
+  {
+    countdown  -=  static_cast<int64_t>(size);
+    if (countdown  >=  0)  {  return;  }
+    if (0  ==  rnd)
+    {  // first allocation of the thread: its countdown starts here, the allocation is not sampled for free
+      countdown  =  next_interval()  -  static_cast<int64_t>(size);
+      if (countdown  >=  0)  {  return;  }
+    }
+    countdown  =  next_interval();
+    record(ptr,  size);
+  }
+
+  /**
+   * @brief on_free - called by ffree for each deallocation
+   * @param ptr  -  allocation ptr
+   * @return - slots probed (at most DEF_Heap_profile_Probe)
+   */
+  int  on_free(void  *ptr)
+  {
+    if (0  ==  live_cnt.load(std::memory_order_relaxed))  {  return  0;  }
+    uint64_t  id  =  slot_id(ptr);
+    int  i  =  0;
+    while (i  <  Probe_Max)
+    {
+      Slot  &slot  =  slots[id];
+      uintptr_t  key  =  slot.key.load(std::memory_order_acquire);
+      ++i;
+      if (reinterpret_cast<uintptr_t>(ptr)  ==  key)
+      {
+        if (slot.key.compare_exchange_strong(key,  TOMBSTONE,  std::memory_order_acq_rel))
+        {
+          live_cnt.fetch_sub(1,  std::memory_order_relaxed);
+        }
+        break;
+      }
+      if (EMPTY  ==  key)  {  break;  }  // end of the probe chain: was not sampled
+      id  =  (id  +  1)  &  (DEF_Heap_profile_Slots  -  1);
+    }
+    return  i;
+  }
+
+  /**
+   * @brief set_sample_rate
+   * The calling thread starts a new countdown at once,
+   * the other threads use the new rate after their next sample.
+   * @param rate - average bytes between samples, 1 == sample every allocation
+   */
+  void  set_sample_rate(int64_t  rate)
+  {
+    sample_rate.store(rate  >  0  ?  rate  :  1,  std::memory_order_relaxed);
+    countdown  =  next_interval();
+  }
+
+  int64_t  get_sample_rate()  const
+  {
+    return  sample_rate.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief heap_profile
+   * @return - the sampled live heap in the legacy heap profile text format
+   */
+  std::string  heap_profile()  const
+  {
+    struct Stat  {  int64_t  cnt  {  0  };  int64_t  bytes  {  0  };  };
+    std::map<std::vector<void  *>,  Stat>  map_stacks;
+    Stat  total;
+    for (int  i  =  0;  i  <  DEF_Heap_profile_Slots;  ++i)
+    {
+      const Slot  &slot  =  slots[i];
+      const uintptr_t  key  =  slot.key.load(std::memory_order_acquire);
+      if (EMPTY  ==  key  ||  TOMBSTONE  ==  key  ||  RESERVED  ==  key)  {  continue;  }
+      Stat  &stat  =  map_stacks[std::vector<void  *>(slot.stack,  slot.stack  +  slot.depth)];
+      ++stat.cnt;
+      stat.bytes  +=  slot.size;
+      ++total.cnt;
+      total.bytes  +=  slot.size;
+    }
+
+    std::ostringstream  out;
+    out  <<  "heap profile: "  <<  total.cnt  <<  ": "  <<  total.bytes
+         <<  " ["  <<  total.cnt  <<  ": "  <<  total.bytes  <<  "] @ heap_v2/"  <<  get_sample_rate()  <<  "\n";
+    for (auto  &&it  :  map_stacks)
+    {
+      out  <<  it.second.cnt  <<  ": "  <<  it.second.bytes
+           <<  " ["  <<  it.second.cnt  <<  ": "  <<  it.second.bytes  <<  "] @";
+      for (void  *addr  :  it.first)
+      {
+        out  <<  " "  <<  addr;
+      }
+      out  <<  "\n";
+    }
+    // pprof needs the memory map to symbolize the addresses:
+    out  <<  "\nMAPPED_LIBRARIES:\n";
+    std::ifstream  maps("/proc/self/maps");
+    if (maps)  {  out  <<  maps.rdbuf();  }
+    return  out.str();
+  }  // heap_profile
+
+  /**
+   * @brief save_heap_profile
+   * @param file_name  -  where to save heap_profile()
+   * @return - true on success
+   */
+  bool  save_heap_profile(const char  *file_name)  const
+  {
+    std::ofstream  file(file_name,  std::ios::out  |  std::ios::trunc);
+    if (!file)  {  return  false;  }
+    file  <<  heap_profile();
+    return  file.good();
+  }
+
+  // Sampled allocations that are alive now:
+  int  get_live_cnt()  const
+  {
+    return  live_cnt.load(std::memory_order_relaxed);
+  }
+
+private:
+  // Slot keys besides the allocation pointers:
+  static constexpr uintptr_t  EMPTY  {  0  };
+  static constexpr uintptr_t  TOMBSTONE  {  1  };
+  static constexpr uintptr_t  RESERVED  {  2  };
+  static constexpr int  Probe_Max  {  DEF_Heap_profile_Probe  <  DEF_Heap_profile_Slots  ?  DEF_Heap_profile_Probe  :  DEF_Heap_profile_Slots  };
+
+  struct Slot {
+    std::atomic<uintptr_t>  key  {  EMPTY  };
+    std::size_t  size  {  0  };
+    int  depth  {  0  };
+    void  *stack[DEF_Heap_profile_Depth]  {};
+  };
+
+  static uint64_t  slot_id(void  *ptr)
+  {
+    uint64_t  h  =  reinterpret_cast<uint64_t>(ptr);
+    h  ^=  h  >>  33;
+    h  *=  0xff51afd7ed558ccdULL;
+    h  ^=  h  >>  33;
+    return  h  &  (DEF_Heap_profile_Slots  -  1);
+  }
+
+  // Exponential distribution gives a Poisson sampling process with the mean of sample_rate bytes:
+  int64_t  next_interval()
+  {
+    if (0  ==  rnd)  {  rnd  =  reinterpret_cast<uint64_t>(&rnd)  |  1;  }
+    // xorshift64:
+    rnd  ^=  rnd  <<  13;
+    rnd  ^=  rnd  >>  7;
+    rnd  ^=  rnd  <<  17;
+    const double  q  =  static_cast<double>((rnd  >>  11)  +  1)  /  9007199254740993.0;  // (0, 1]
+    const int64_t  rate  =  get_sample_rate();
+    if (rate  <=  1)  {  return  0;  }
+    return  static_cast<int64_t>(-log(q)  *  rate);
+  }
+
+  FMP_NOINLINE  void  record(void  *ptr,  std::size_t  size)
+  {
+    uint64_t  id  =  slot_id(ptr);
+    for (int  i  =  0;  i  <  Probe_Max;  ++i)
+    {
+      Slot  &slot  =  slots[id];
+      uintptr_t  key  =  slot.key.load(std::memory_order_relaxed);
+      if ((EMPTY  ==  key  ||  TOMBSTONE  ==  key)
+          &&  slot.key.compare_exchange_strong(key,  RESERVED,  std::memory_order_acquire))
+      {
+        slot.size  =  size;
+#if defined(__linux__) || defined(__APPLE__)
+        // skip this record() frame:
+        void  *stack[DEF_Heap_profile_Depth  +  1];
+        const int  depth  =  backtrace(stack,  DEF_Heap_profile_Depth  +  1);
+        slot.depth  =  depth  >  1  ?  depth  -  1  :  0;
+        for (int  j  =  0;  j  <  slot.depth;  ++j)  {  slot.stack[j]  =  stack[j  +  1];  }
+#else
+        slot.depth  =  0;
+#endif
+        live_cnt.fetch_add(1,  std::memory_order_relaxed);
+        slot.key.store(reinterpret_cast<uintptr_t>(ptr),  std::memory_order_release);
+        return;
+      }
+      id  =  (id  +  1)  &  (DEF_Heap_profile_Slots  -  1);
+    }
+    // no free slot near the hash: the sample is lost
+    return;
+  }
+
+  static thread_local  int64_t  countdown;
+  static thread_local  uint64_t  rnd;
+  std::atomic<int64_t>  sample_rate  {  DEF_Heap_profile_Rate  };
+  std::atomic<int>  live_cnt  {  0  };
+  Slot  slots[DEF_Heap_profile_Slots];
+};
+
+inline thread_local  int64_t  FastMemPoolProfiler::countdown  {  0  };
+inline thread_local  uint64_t  FastMemPoolProfiler::rnd  {  0  };
+
+// The one profiler of the process, constant initialized (no static init guard on the hot path):
+inline FastMemPoolProfiler  fast_mem_pool_profiler;
+
+#endif // FastMemPoolProfiler_H
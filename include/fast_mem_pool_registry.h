@@ -0,0 +1,241 @@
+/*
+ * This is the source code of SpecNet project
+ * It is licensed under MIT License.
+ *
+ * Copyright (c) Dmitriy Bondarenko
+ * feel free to contact me: specnet.messenger@gmail.com
+ */
+
+#ifndef FastMemPoolRegistry_H
+#define FastMemPoolRegistry_H
+
+#include <atomic>
+#include <stdint.h>
+#include <stdlib.h>
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+// Max pools registered at the same time:
+#ifndef DEF_Pool_registry_Pools
+#define DEF_Pool_registry_Pools  1024
+#endif
+
+/*
+ * FastMemPoolRegistry
+ * Process-wide registry of the leaf ranges of all FastMemPool instances
+ * (of any template parameters, compiled in if defined(DEF_Pool_registry)).
+ * A two level page map (48 bit addresses, 4 KiB pages) gives the owner of a page
+ * without locks: the leaves of one pool are registered by its constructor, fm_free(ptr)
+ * finds the owner and calls its ffree. A page only partly covered by leaves (leaves taken
+ * with malloc) is marked Shared and the owners are asked one by one, so the lookup is exact.
+ * The page map arrays are taken with mmap, never malloc, and are never freed,
+ * so the registry works inside a malloc replacement and during static destruction.
+ */
+class FastMemPoolRegistry
+{
+public:
+  // Type erased owner pool:
+  struct Owner {
+    std::atomic<void  *>  pool  {  nullptr  };
+    std::atomic<bool>  ready  {  false  };
+    // pool->ffree(ptr):
+    void  (*free_fn)(void  *pool,  void  *ptr)  {  nullptr  };
+    // true if ptr lies in the leaves of pool:
+    bool  (*owns_fn)(const void  *pool,  const void  *ptr)  {  nullptr  };
+  };
+
+  constexpr FastMemPoolRegistry()  {}
+
+  /**
+   * @brief add_owner
+   * @return - owner id for add_range/remove_owner, -1 if DEF_Pool_registry_Pools are registered
+   */
+  int  add_owner(void  *pool,  void  (*free_fn)(void  *,  void  *),  bool  (*owns_fn)(const void  *,  const void  *),
+                 bool  (*free_os_fn)(void  *))
+  {
+    for (int  id  =  0;  id  <  DEF_Pool_registry_Pools;  ++id)
+    {
+      void  *expected  =  nullptr;
+      if (owners[id].pool.compare_exchange_strong(expected,  pool,  std::memory_order_acq_rel))
+      {
+        owners[id].free_fn  =  free_fn;
+        owners[id].owns_fn  =  owns_fn;
+        owners[id].ready.store(true,  std::memory_order_release);
+        free_os.store(free_os_fn,  std::memory_order_release);
+        return  id;
+      }
+    }
+    return  -1;
+  }
+
+  // Register the pages of [begin, end) for the owner:
+  void  add_range(int  owner_id,  const void  *begin,  std::size_t  bytes)
+  {
+    if (owner_id  <  0  ||  !begin  ||  0  ==  bytes)  {  return;  }
+    const uint16_t  tag  =  static_cast<uint16_t>(owner_id  +  1);
+    const uintptr_t  begin_addr  =  reinterpret_cast<uintptr_t>(begin);
+    const uintptr_t  end_addr  =  begin_addr  +  bytes;
+    const uintptr_t  first  =  begin_addr  >>  Page_Shift;
+    const uintptr_t  last  =  (end_addr  -  1)  >>  Page_Shift;
+    for (uintptr_t  page  =  first;  page  <=  last;  ++page)
+    {
+      std::atomic<uint16_t>  *entry  =  page_entry(page,  true);
+      if (!entry)  {  continue;  }
+      // a partly covered page may hold the other memory, the owner is asked there:
+      const bool  partial  =  (page  ==  first  &&  (begin_addr  &  (Page_Bytes  -  1)))
+                         ||  (page  ==  last  &&  (end_addr  &  (Page_Bytes  -  1)));
+      uint16_t  expected  =  Free;
+      if (partial  ||  (!entry->compare_exchange_strong(expected,  tag,  std::memory_order_acq_rel)  &&  expected  !=  tag))
+      {  // leaves of several pools on the page:
+        entry->store(Shared,  std::memory_order_release);
+      }
+    }
+  }
+
+  // Unregister the pool, its pages were given with add_range:
+  void  remove_owner(int  owner_id,  const void  *begin,  std::size_t  bytes)
+  {
+    if (owner_id  <  0)  {  return;  }
+    const uint16_t  tag  =  static_cast<uint16_t>(owner_id  +  1);
+    owners[owner_id].ready.store(false,  std::memory_order_release);
+    if (begin  &&  bytes)
+    {
+      const uintptr_t  first  =  reinterpret_cast<uintptr_t>(begin)  >>  Page_Shift;
+      const uintptr_t  last  =  (reinterpret_cast<uintptr_t>(begin)  +  bytes  -  1)  >>  Page_Shift;
+      for (uintptr_t  page  =  first;  page  <=  last;  ++page)
+      {
+        std::atomic<uint16_t>  *entry  =  page_entry(page,  false);
+        uint16_t  expected  =  tag;
+        // (a Shared page stays Shared, the lookup asks the owners)
+        if (entry)  {  entry->compare_exchange_strong(expected,  Free,  std::memory_order_acq_rel);  }
+      }
+    }
+  }
+
+  // After remove_owner() for every range of the owner:
+  void  release_owner(int  owner_id)
+  {
+    if (owner_id  >=  0)  {  owners[owner_id].pool.store(nullptr,  std::memory_order_release);  }
+  }
+
+  /**
+   * @brief find - lock-free owner lookup
+   * @param ptr  -  any address
+   * @return - owner whose leaves contain ptr or nullptr
+   */
+  const Owner  * find(const void  *ptr)  const
+  {
+    const uintptr_t  page  =  reinterpret_cast<uintptr_t>(ptr)  >>  Page_Shift;
+    if (page  >>  (L1_Bits  +  L2_Bits))  {  return  nullptr;  }
+    const std::atomic<uint16_t>  *l2  =  map[page  >>  L2_Bits].load(std::memory_order_acquire);
+    if (!l2)  {  return  nullptr;  }
+    const uint16_t  tag  =  l2[page  &  (L2_Size  -  1)].load(std::memory_order_acquire);
+    if (Free  ==  tag)  {  return  nullptr;  }
+    if (Shared  !=  tag)
+    {
+      const Owner  &owner  =  owners[tag  -  1];
+      return  owner.ready.load(std::memory_order_acquire)  ?  &owner  :  nullptr;
+    }
+    for (const Owner  &owner  :  owners)
+    {
+      if (owner.ready.load(std::memory_order_acquire)
+          &&  owner.owns_fn(owner.pool.load(std::memory_order_relaxed),  ptr))
+      {
+        return  &owner;
+      }
+    }
+    return  nullptr;
+  }
+
+  /**
+   * @brief free_ptr - ffree of the owner pool
+   * @param ptr  -  allocation of any registered pool
+   * @return - false if ptr is not a FastMemPool allocation (nothing is done)
+   */
+  bool  free_ptr(void  *ptr)
+  {
+    if (!ptr)  {  return  true;  }
+    // (the byte before ptr belongs to the same leaf even for an empty allocation at the leaf end)
+    const Owner  *owner  =  find(static_cast<char  *>(ptr)  -  1);
+    if (owner)
+    {
+      owner->free_fn(owner->pool.load(std::memory_order_relaxed),  ptr);
+      return  true;
+    }
+    // OS malloc fallbacks of the pools are not in the leaves, their header says it:
+    bool  (*free_os_fn)(void  *)  =  free_os.load(std::memory_order_acquire);
+    return  free_os_fn  &&  free_os_fn(ptr);
+  }
+
+private:
+  static constexpr int  Page_Shift  {  12  };
+  static constexpr uintptr_t  Page_Bytes  {  uintptr_t(1)  <<  Page_Shift  };
+  static constexpr int  L1_Bits  {  18  };
+  static constexpr int  L2_Bits  {  18  };
+  static constexpr std::size_t  L2_Size  {  std::size_t(1)  <<  L2_Bits  };
+  static constexpr uint16_t  Free  {  0  };
+  static constexpr uint16_t  Shared  {  0xFFFF  };
+  static_assert(DEF_Pool_registry_Pools  <  Shared,  "owner id + 1 must fit uint16_t below Shared");
+
+  std::atomic<uint16_t>  * page_entry(uintptr_t  page,  bool  create)
+  {
+    if (page  >>  (L1_Bits  +  L2_Bits))  {  return  nullptr;  }
+    std::atomic<std::atomic<uint16_t>  *>  &slot  =  map[page  >>  L2_Bits];
+    std::atomic<uint16_t>  *l2  =  slot.load(std::memory_order_acquire);
+    if (!l2  &&  create)
+    {
+      std::atomic<uint16_t>  *fresh  =  alloc_l2();
+      if (!fresh)  {  return  nullptr;  }
+      if (slot.compare_exchange_strong(l2,  fresh,  std::memory_order_acq_rel))
+      {
+        l2  =  fresh;
+      }  else  {  // the other thread was faster, l2 is its array:
+        free_l2(fresh);
+      }
+    }
+    return  l2  ?  &l2[page  &  (L2_Size  -  1)]  :  nullptr;
+  }
+
+  // zero filled pages, all entries are Free:
+  static std::atomic<uint16_t>  * alloc_l2()
+  {
+    const std::size_t  bytes  =  L2_Size  *  sizeof(std::atomic<uint16_t>);
+#if defined(_WIN32)
+    return  static_cast<std::atomic<uint16_t>  *>(VirtualAlloc(nullptr,  bytes,  MEM_RESERVE | MEM_COMMIT,  PAGE_READWRITE));
+#else
+    void  *re  =  mmap(nullptr,  bytes,  PROT_READ | PROT_WRITE,  MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,  -1,  0);
+    return  MAP_FAILED  ==  re  ?  nullptr  :  static_cast<std::atomic<uint16_t>  *>(re);
+#endif
+  }
+
+  static void  free_l2(std::atomic<uint16_t>  *l2)
+  {
+#if defined(_WIN32)
+    VirtualFree(l2,  0,  MEM_RELEASE);
+#else
+    munmap(l2,  L2_Size  *  sizeof(std::atomic<uint16_t>));
+#endif
+  }
+
+  std::atomic<std::atomic<uint16_t>  *>  map[std::size_t(1)  <<  L1_Bits]  {};
+  Owner  owners[DEF_Pool_registry_Pools];
+  std::atomic<bool  (*)(void  *)>  free_os  {  nullptr  };
+};
+
+// The one registry of the process, constant initialized:
+inline FastMemPoolRegistry  fast_mem_pool_registry;
+
+/**
+ * @brief fm_free - ffree without knowing the owner pool
+ * @param ptr  -  allocation of any FastMemPool (leaves or OS malloc fallback)
+ * @return - false if ptr is not a FastMemPool allocation (nothing is done)
+ */
+inline bool  fm_free(void  *ptr)
+{
+  return  fast_mem_pool_registry.free_ptr(ptr);
+}
+
+#endif // FastMemPoolRegistry_H
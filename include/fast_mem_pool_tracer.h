@@ -0,0 +1,221 @@
+/*
+ * This is the source code of SpecNet project
+ * It is licensed under MIT License.
+ *
+ * Copyright (c) Dmitriy Bondarenko
+ * feel free to contact me: specnet.messenger@gmail.com
+ */
+
+#ifndef FastMemPoolTracer_H
+#define FastMemPoolTracer_H
+
+#include <atomic>
+#include <stdint.h>
+#include <chrono>
+#include <algorithm>
+#include <string>
+#include <sstream>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Events kept by each thread (power of 2), older events are overwritten:
+#ifndef DEF_Alloc_trace_Events
+#define DEF_Alloc_trace_Events  8192
+#endif
+// Max threads that can be traced:
+#ifndef DEF_Alloc_trace_Threads
+#define DEF_Alloc_trace_Threads  1024
+#endif
+
+// Which way the fmalloc/ffree went:
+enum class FastMemPoolTracePath : uint8_t {
+  Fast,  // fmalloc: start leaf, ffree: just accounted in its leaf
+  Leaf_switch,  // fmalloc: start leaf was depleted, the allocation was done in the other leaf
+  Leaf_rotate,  // fmalloc: the allocation depleted the leaf and moved cur_leaf
+  OS_malloc,  // fmalloc: fallback to OS malloc, ffree: OS free
+  Leaf_reset,  // ffree: the last allocation of the leaf was returned, leaf is reset
+  Failed  // fmalloc: nullptr
+};
+
+/*
+ * FastMemPoolTracer
+ * In-process fmalloc/ffree event tracer (compiled in if defined(DEF_Alloc_trace)).
+ * Each thread writes into its own ring buffer without locks and atomic RMW:
+ * TSC timestamp, size, leaf id (-1 for OS malloc) and FastMemPoolTracePath.
+ * chrome_trace_json() gives the events in Chrome/Perfetto JSON trace format
+ * (chrome://tracing, ui.perfetto.dev), for example:
+ *   spec::save_text("fmp_trace.json", fast_mem_pool_tracer.chrome_trace_json());
+ */
+class FastMemPoolTracer
+{
+public:
+  constexpr FastMemPoolTracer()  {}
+
+  void  on_fmalloc(std::size_t  size,  int  leaf_id,  FastMemPoolTracePath  path)
+  {
+    record(OP_fmalloc,  size,  leaf_id,  path);
+  }
+
+  void  on_ffree(std::size_t  size,  int  leaf_id,  FastMemPoolTracePath  path)
+  {
+    record(OP_ffree,  size,  leaf_id,  path);
+  }
+
+  void  set_enabled(bool  on)
+  {
+    enabled.store(on,  std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief chrome_trace_json
+   * @return - events of all threads in Chrome trace event JSON format
+   * Diagnostic snapshot: events written while dumping may be torn.
+   */
+  std::string  chrome_trace_json()  const
+  {
+    std::ostringstream  out;
+    out  <<  "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool  first  =  true;
+    const double  ticks_per_us  =  get_ticks_per_us();
+    const uint64_t  tsc0  =  tsc_base.load(std::memory_order_acquire);
+    const int  rings_cnt  =  std::min(ring_cnt.load(std::memory_order_acquire),  DEF_Alloc_trace_Threads);
+    for (int  tid  =  0;  tid  <  rings_cnt;  ++tid)
+    {
+      const Ring  *ring  =  rings[tid].load(std::memory_order_acquire);
+      if (!ring)  {  continue;  }
+      const uint64_t  head  =  ring->head.load(std::memory_order_acquire);
+      const uint64_t  start  =  head  >  DEF_Alloc_trace_Events  ?  head  -  DEF_Alloc_trace_Events  :  0;
+      for (uint64_t  i  =  start;  i  <  head;  ++i)
+      {
+        const Event  &ev  =  ring->events[i  &  (DEF_Alloc_trace_Events  -  1)];
+        if (!first)  {  out  <<  ",";  }
+        first  =  false;
+        const double  ts  =  ev.tsc  >  tsc0  ?  (ev.tsc  -  tsc0)  /  ticks_per_us  :  0.0;
+        out  <<  "\n{\"name\":\""  <<  (OP_fmalloc  ==  ev.op  ?  "fmalloc"  :  "ffree")
+             <<  "\",\"cat\":\""  <<  path_name(ev.path)
+             <<  "\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":"  <<  tid
+             <<  ",\"ts\":"  <<  std::fixed  <<  ts
+             <<  ",\"args\":{\"size\":"  <<  ev.size  <<  ",\"leaf\":"  <<  ev.leaf_id
+             <<  ",\"path\":\""  <<  path_name(ev.path)  <<  "\"}}";
+      }
+    }
+    out  <<  "\n]}\n";
+    return  out.str();
+  }  // chrome_trace_json
+
+private:
+  static constexpr uint8_t  OP_fmalloc  {  0  };
+  static constexpr uint8_t  OP_ffree  {  1  };
+
+  struct Event {
+    uint64_t  tsc;
+    uint32_t  size;
+    // -1 - OS malloc (or no leaf):
+    int32_t  leaf_id;
+    uint8_t  op;
+    FastMemPoolTracePath  path;
+  };
+
+  struct Ring {
+    // only the owner thread writes:
+    std::atomic<uint64_t>  head  {  0  };
+    Event  events[DEF_Alloc_trace_Events];
+  };
+
+  static uint64_t  now_tsc()
+  {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+    return  __rdtsc();
+#else
+    return  std::chrono::duration_cast<std::chrono::nanoseconds>
+        (std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+  }
+
+  static int64_t  now_ns()
+  {
+    return  std::chrono::duration_cast<std::chrono::nanoseconds>
+        (std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  static const char  * path_name(FastMemPoolTracePath  path)
+  {
+    switch (path)  {
+      case FastMemPoolTracePath::Fast:  return  "fast";
+      case FastMemPoolTracePath::Leaf_switch:  return  "leaf_switch";
+      case FastMemPoolTracePath::Leaf_rotate:  return  "leaf_rotate";
+      case FastMemPoolTracePath::OS_malloc:  return  "os";
+      case FastMemPoolTracePath::Leaf_reset:  return  "leaf_reset";
+      default:  return  "failed";
+    }
+  }
+
+  // TSC frequency measured between the first traced event and now:
+  double  get_ticks_per_us()  const
+  {
+    const int64_t  ns  =  now_ns()  -  ns_base.load(std::memory_order_acquire);
+    const uint64_t  ticks  =  now_tsc()  -  tsc_base.load(std::memory_order_acquire);
+    if (ns  <=  0  ||  0  ==  ticks)  {  return  1000.0;  }
+    return  static_cast<double>(ticks)  *  1000.0  /  ns;
+  }
+
+  void  record(uint8_t  op,  std::size_t  size,  int  leaf_id,  FastMemPoolTracePath  path)
+  {
+    if (!enabled.load(std::memory_order_relaxed))  {  return;  }
+    Ring  *ring  =  thread_ring;
+    if (!ring)
+    {
+      if (!enabled_for_thread)  {  return;  }
+      ring  =  register_thread();
+      if (!ring)  {  return;  }
+    }
+    const uint64_t  head  =  ring->head.load(std::memory_order_relaxed);
+    Event  &ev  =  ring->events[head  &  (DEF_Alloc_trace_Events  -  1)];
+    ev.tsc  =  now_tsc();
+    ev.size  =  static_cast<uint32_t>(size);
+    ev.leaf_id  =  leaf_id  <  0  ?  -1  :  static_cast<int32_t>(leaf_id);
+    ev.op  =  op;
+    ev.path  =  path;
+    ring->head.store(head  +  1,  std::memory_order_release);
+    return;
+  }
+
+  Ring  * register_thread()
+  {
+    const int  id  =  ring_cnt.fetch_add(1,  std::memory_order_acq_rel);
+    if (id  >=  DEF_Alloc_trace_Threads)
+    {  // no more rings, this thread will not be traced:
+      thread_ring  =  nullptr;
+      enabled_for_thread  =  false;
+      return  nullptr;
+    }
+    if (0  ==  id)
+    {
+      ns_base.store(now_ns(),  std::memory_order_relaxed);
+      tsc_base.store(now_tsc(),  std::memory_order_release);
+    }
+    // Rings are never freed: events of finished threads stay in the dump
+    thread_ring  =  new Ring();
+    rings[id].store(thread_ring,  std::memory_order_release);
+    return  thread_ring;
+  }
+
+  static thread_local  Ring  *thread_ring;
+  static thread_local  bool  enabled_for_thread;
+  std::atomic<bool>  enabled  {  true  };
+  std::atomic<int>  ring_cnt  {  0  };
+  std::atomic<uint64_t>  tsc_base  {  0  };
+  std::atomic<int64_t>  ns_base  {  0  };
+  std::atomic<Ring  *>  rings[DEF_Alloc_trace_Threads]  {};
+};
+
+inline thread_local  FastMemPoolTracer::Ring  *FastMemPoolTracer::thread_ring  {  nullptr  };
+inline thread_local  bool  FastMemPoolTracer::enabled_for_thread  {  true  };
+
+// The one tracer of the process, constant initialized:
+inline FastMemPoolTracer  fast_mem_pool_tracer;
+
+#endif // FastMemPoolTracer_H
@@ -0,0 +1,134 @@
+/*
+ * This is the source code of SpecNet project
+ * It is licensed under MIT License.
+ *
+ * Copyright (c) Dmitriy Bondarenko
+ * feel free to contact me: specnet.messenger@gmail.com
+ */
+
+#ifndef FastObjectPool_H
+#define FastObjectPool_H
+
+#include "fast_mem_pool.h"
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/*
+ * FastObjectPool
+ * Thread-safe pool of T objects: the slots are cut by a FastMemPoolNodeCache from chunks of the
+ * FastMemPool leaves (Chunk_Nodes slots a chunk, no AllocHeader per object), create/destroy are
+ * a pop/push of its lock-free tagged free list.
+ * Cache_Constructed = true (slab cache): destroy(p) does not run the destructor, the object waits
+ * constructed on the second list and create() gives it back as it was left: the constructor runs
+ * once per slot, the destructor in ~FastObjectPool. The owner resets the state the next owner
+ * needs, as SpecStackPool::get() calls clear().
+ * Every object must be destroyed before the pool, the chunks go back to FastMemPool with it.
+
+ FastObjectPool<Session, FastMemPool<1048576, 64>>  sessions(&pool);
+ Session  *session  =  sessions.create(socket_fd);
+ sessions.destroy(session);
+ */
+template<class T, class FAllocator = FastMemPoolNull, bool Cache_Constructed = false>
+class FastObjectPool
+{
+public:
+  using  MyAllocatorType = typename std::conditional<std::is_same<FAllocator,  FastMemPoolNull>::value,
+    FastMemPool<>,  FAllocator>::type;
+  using  NodeCache = FastMemPoolNodeCache<MyAllocatorType>;
+
+  explicit FastObjectPool(MyAllocatorType  *in_allocator  =  nullptr)
+    :  slots(NodeCache::create(in_allocator  ?  in_allocator  :  MyAllocatorType::instance())),
+       idle(Cache_Constructed  ?  NodeCache::create(slots->get_pool())  :  nullptr)
+  {
+    // the stride of the slots is fixed before any thread allocates:
+    slots->template takes<Slot>(true);
+  }
+  FastObjectPool(const FastObjectPool  &)  =  delete;
+  FastObjectPool  & operator=(const FastObjectPool  &)  =  delete;
+
+  ~FastObjectPool()
+  {
+    if (idle)
+    {
+      while (void  *slot  =  idle->try_pop())  {  object_of(slot)->~T();  }
+      idle->release();
+    }
+    slots->release();
+  }
+
+  /**
+   * @brief create
+   * @param args  -  arguments of the T constructor (Cache_Constructed: none, T is default constructed)
+   * @return - the object, std::bad_alloc if the pool gives no memory (the exception of T is passed through)
+   */
+  template<class... Args>
+  T  * create(Args&&... args)
+  {
+    if constexpr (Cache_Constructed)
+    {
+      static_assert(0  ==  sizeof...(Args),  "FastObjectPool: the cached objects are default constructed, create() takes no arguments");
+      if (void  *slot  =  idle->try_pop())  {  return  object_of(slot);  }
+    }
+    void  *slot  =  slots->pop();
+    if (!slot)  {  throw  std::bad_alloc();  }
+    try  {
+      return  new (object_place(slot)) T(std::forward<Args>(args)...);
+    }  catch (...)  {
+      slots->push(slot);
+      throw;
+    }
+  }
+
+  /**
+   * @brief destroy - the object goes back to the pool (Cache_Constructed: still constructed)
+   * @param obj  -  create() of this pool or nullptr
+   */
+  void  destroy(T  *obj)
+  {
+    if (!obj)  {  return;  }
+    if constexpr (Cache_Constructed)
+    {
+      idle->push(slot_of(obj));
+    }  else  {
+      obj->~T();
+      slots->push(slot_of(obj));
+    }
+  }
+
+  MyAllocatorType  * get_pool()  const  noexcept  {  return  slots->get_pool();  }
+
+private:
+  // the free list link overlays a free slot, a cached object keeps its state: the link goes before it
+  struct PlainSlot {
+    alignas(T)  unsigned char  object[sizeof(T)];
+  };
+  struct CachedSlot {
+    void  *next;
+    alignas(T)  unsigned char  object[sizeof(T)];
+  };
+  using  Slot = typename std::conditional<Cache_Constructed,  CachedSlot,  PlainSlot>::type;
+  static_assert(NodeCache::template node_stride<Slot>()  >  0,  "FastObjectPool: alignof(T) is over FastMemPoolNodeCache::Node_Align");
+
+  static void  * object_place(void  *slot)  noexcept
+  {
+    return  static_cast<Slot  *>(slot)->object;
+  }
+
+  static T  * object_of(void  *slot)  noexcept
+  {
+    return  std::launder(reinterpret_cast<T  *>(object_place(slot)));
+  }
+
+  static void  * slot_of(T  *obj)  noexcept
+  {
+    return  reinterpret_cast<char  *>(obj)  -  offsetof(Slot,  object);
+  }
+
+  NodeCache  *slots;
+  // Cache_Constructed: the destroyed objects, never refilled
+  NodeCache  *idle;
+};
+
+#endif // FastObjectPool_H
@@ -0,0 +1,342 @@
+/*
+ * This is the source code of SpecNet project
+ * It is licensed under MIT License.
+ *
+ * Copyright (c) Dmitriy Bondarenko
+ * feel free to contact me: specnet.messenger@gmail.com
+ */
+
+/*
+ * libfast_mem_pool_preload.so
+ * malloc/free/calloc/realloc/posix_memalign/malloc_usable_size and the C++ operator new/delete
+ * family served by one FastMemPool, for unmodified binaries:
+ *   LD_PRELOAD=/path/libfast_mem_pool_preload.so ./my_exe
+ * Environment (read once, by the first allocation):
+ *   FMP_DISABLE=1  -  everything goes to glibc malloc
+ *   FMP_PROVISION=eager|lazy|prefault|pretouch  -  see FastMemPoolProvision (eager by default)
+ *   FMP_PRETOUCH_THREADS=N  -  helper threads for pretouch (0 == hardware concurrency)
+ *   FMP_MAX_SIZE=bytes  -  bigger allocations go to glibc malloc (Leaf_Size_Bytes / 4 by default)
+ * The leaves are one mmap'ed range, so the owner check of free() is a range compare:
+ * the pointers taken before the pool was ready (dynamic loader, other constructors),
+ * the aligned allocations, the fallbacks of a depleted pool are glibc's and go back to glibc.
+ */
+
+#include "fast_mem_pool.h"
+#include <new>
+#include <errno.h>
+#include <malloc.h>
+#include <dlfcn.h>
+
+#ifndef DEF_Preload_Leaf_Size_Bytes
+#define DEF_Preload_Leaf_Size_Bytes  1048576
+#endif
+#ifndef DEF_Preload_Leaf_Cnt
+#define DEF_Preload_Leaf_Cnt  1024
+#endif
+
+#if !defined(DEF_Leaf_mmap)
+#error "the preload library needs DEF_Leaf_mmap: free() of a foreign pointer must not read its header"
+#endif
+
+// glibc's own allocator, it stays reachable under the interposed names:
+extern "C" {
+void  * __libc_malloc(size_t  size);
+void  __libc_free(void  *ptr);
+void  * __libc_calloc(size_t  cnt,  size_t  size);
+void  * __libc_realloc(void  *ptr,  size_t  size);
+void  * __libc_memalign(size_t  alignment,  size_t  size);
+}
+
+namespace {
+
+// no OS malloc fallback inside the pool: a depleted pool returns nullptr and the caller goes to glibc
+using  TPreloadPool = FastMemPool<DEF_Preload_Leaf_Size_Bytes,  DEF_Preload_Leaf_Cnt,  256,  false,  false>;
+
+// malloc() must return memory aligned for any fundamental type:
+constexpr std::size_t  Malloc_Align  {  16  };
+static_assert(0  ==  DEF_Preload_Leaf_Size_Bytes  %  Malloc_Align,  "leaf allocations must stay on Malloc_Align");
+static_assert(0  ==  TPreloadPool::get_header_size()  %  Malloc_Align,  "the allocation must follow the header on Malloc_Align");
+
+enum  PoolState  :  int  {
+  State_None,  // nobody asked yet
+  State_Init,  // the constructor is running: its own allocations go to glibc
+  State_Ready,
+  State_Disabled  // FMP_DISABLE
+};
+
+// The pool is never destroyed: free() may come after the static destructors
+alignas(TPreloadPool)  unsigned char  pool_storage[sizeof(TPreloadPool)];
+TPreloadPool  *pool  {  nullptr  };
+std::atomic<int>  pool_state  {  State_None  };
+std::atomic<std::size_t>  max_size  {  DEF_Preload_Leaf_Size_Bytes  /  4  };
+
+long  env_long(const char  *name,  long  def)
+{
+  const char  *value  =  getenv(name);
+  return  value  &&  *value  ?  strtol(value,  nullptr,  10)  :  def;
+}
+
+FastMemPoolProvision  env_provision()
+{
+  const char  *value  =  getenv("FMP_PROVISION");
+  if (value)
+  {
+    if (0  ==  strcmp(value,  "lazy"))  {  return  FastMemPoolProvision::Lazy;  }
+    if (0  ==  strcmp(value,  "prefault"))  {  return  FastMemPoolProvision::Prefault;  }
+    if (0  ==  strcmp(value,  "pretouch"))  {  return  FastMemPoolProvision::Pretouch;  }
+  }
+  return  FastMemPoolProvision::Eager;
+}
+
+int  pool_init()
+{
+  int  expected  =  State_None;
+  if (!pool_state.compare_exchange_strong(expected,  State_Init,  std::memory_order_acq_rel))
+  {
+    return  expected;
+  }
+  if (env_long("FMP_DISABLE",  0))
+  {
+    pool_state.store(State_Disabled,  std::memory_order_release);
+    return  State_Disabled;
+  }
+  // the largest size that still keeps Malloc_Align after rounding:
+  const long  limit  =  DEF_Preload_Leaf_Size_Bytes  -  TPreloadPool::get_header_size()  -  Malloc_Align;
+  const long  size  =  env_long("FMP_MAX_SIZE",  DEF_Preload_Leaf_Size_Bytes  /  4);
+  max_size.store(size  <  0  ?  0  :  std::min(size,  limit),  std::memory_order_relaxed);
+  pool  =  new (pool_storage) TPreloadPool(env_provision(),  static_cast<int>(env_long("FMP_PRETOUCH_THREADS",  0)));
+  pool_state.store(State_Ready,  std::memory_order_release);
+  return  State_Ready;
+}
+
+inline bool  pool_ready()
+{
+  const int  state  =  pool_state.load(std::memory_order_acquire);
+  if (State_Ready  ==  state)  {  return  true;  }
+  return  State_None  ==  state  &&  State_Ready  ==  pool_init();
+}
+
+inline bool  pool_owns(const void  *ptr)
+{
+  return  State_Ready  ==  pool_state.load(std::memory_order_acquire)  &&  pool->owns(ptr);
+}
+
+// header + allocation is a multiple of Malloc_Align, an empty allocation still takes a byte
+// (so the pointer never sits on the leaf end):
+inline std::size_t  round_size(std::size_t  size)
+{
+  const std::size_t  header  =  TPreloadPool::get_header_size();
+  return  ((std::max<std::size_t>(size,  1)  +  header  +  Malloc_Align  -  1)  &  ~(Malloc_Align  -  1))  -  header;
+}
+
+inline void  * preload_malloc(std::size_t  size)
+{
+  if (size  <=  max_size.load(std::memory_order_relaxed)  &&  pool_ready())
+  {
+    void  *re  =  pool->fmalloc(round_size(size));
+    if (re)  {  return  re;  }
+  }
+  return  __libc_malloc(size);
+}
+
+inline void  preload_free(void  *ptr)
+{
+  if (!ptr)  {  return;  }
+  if (pool_owns(ptr))
+  {
+    pool->ffree(ptr);
+  }  else  {
+    __libc_free(ptr);
+  }
+}
+
+inline void  * preload_memalign(std::size_t  alignment,  std::size_t  size)
+{
+  if (alignment  <=  Malloc_Align)  {  return  preload_malloc(size);  }
+  return  __libc_memalign(alignment,  size);
+}
+
+void  * preload_realloc(void  *ptr,  std::size_t  size)
+{
+  if (!ptr)  {  return  preload_malloc(size);  }
+  if (!pool_owns(ptr))  {  return  __libc_realloc(ptr,  size);  }
+  if (0  ==  size)
+  {
+    pool->ffree(ptr);
+    return  nullptr;
+  }
+  const std::size_t  old_size  =  pool->alloc_size(ptr);
+  if (size  <=  old_size)  {  return  ptr;  }
+  void  *re  =  preload_malloc(size);
+  if (re)
+  {
+    memcpy(re,  ptr,  old_size);
+    pool->ffree(ptr);
+  }
+  return  re;
+}
+
+std::size_t  foreign_usable_size(void  *ptr)
+{
+  using  TUsableSize = std::size_t (*)(void  *);
+  static std::atomic<TUsableSize>  next  {  nullptr  };
+  TUsableSize  fun  =  next.load(std::memory_order_acquire);
+  if (!fun)
+  {
+    fun  =  reinterpret_cast<TUsableSize>(dlsym(RTLD_NEXT,  "malloc_usable_size"));
+    if (!fun)  {  return  0;  }
+    next.store(fun,  std::memory_order_release);
+  }
+  return  fun(ptr);
+}
+
+void  * new_impl(std::size_t  size,  std::size_t  alignment)
+{
+  for (;;)
+  {
+    void  *re  =  preload_memalign(alignment,  size);
+    if (re)  {  return  re;  }
+    std::new_handler  handler  =  std::get_new_handler();
+    if (!handler)  {  throw  std::bad_alloc();  }
+    handler();
+  }
+}
+
+void  * new_nothrow(std::size_t  size,  std::size_t  alignment)  noexcept
+{
+  try  {
+    return  new_impl(size,  alignment);
+  }  catch (...)  {
+    return  nullptr;
+  }
+}
+
+}  // namespace
+
+extern "C" {
+
+void  * malloc(size_t  size)  noexcept
+{
+  return  preload_malloc(size);
+}
+
+void  free(void  *ptr)  noexcept
+{
+  preload_free(ptr);
+}
+
+void  * calloc(size_t  cnt,  size_t  size)  noexcept
+{
+  size_t  bytes  =  0;
+  if (__builtin_mul_overflow(cnt,  size,  &bytes))
+  {
+    errno  =  ENOMEM;
+    return  nullptr;
+  }
+  if (bytes  <=  max_size.load(std::memory_order_relaxed)  &&  pool_ready())
+  {
+    void  *re  =  pool->fmalloc(round_size(bytes));
+    if (re)
+    {  // leaves are reused, unlike fresh mmap pages:
+      memset(re,  0,  bytes);
+      return  re;
+    }
+  }
+  return  __libc_calloc(cnt,  size);
+}
+
+void  * realloc(void  *ptr,  size_t  size)  noexcept
+{
+  return  preload_realloc(ptr,  size);
+}
+
+void  * reallocarray(void  *ptr,  size_t  cnt,  size_t  size)  noexcept
+{
+  size_t  bytes  =  0;
+  if (__builtin_mul_overflow(cnt,  size,  &bytes))
+  {
+    errno  =  ENOMEM;
+    return  nullptr;
+  }
+  return  preload_realloc(ptr,  bytes);
+}
+
+int  posix_memalign(void  **out,  size_t  alignment,  size_t  size)  noexcept
+{
+  if (alignment  <  sizeof(void  *)  ||  (alignment  &  (alignment  -  1)))  {  return  EINVAL;  }
+  void  *re  =  preload_memalign(alignment,  size);
+  if (!re)  {  return  ENOMEM;  }
+  *out  =  re;
+  return  0;
+}
+
+void  * aligned_alloc(size_t  alignment,  size_t  size)  noexcept
+{
+  return  preload_memalign(alignment,  size);
+}
+
+void  * memalign(size_t  alignment,  size_t  size)  noexcept
+{
+  return  preload_memalign(alignment,  size);
+}
+
+size_t  malloc_usable_size(void  *ptr)  noexcept
+{
+  if (!ptr)  {  return  0;  }
+  return  pool_owns(ptr)  ?  pool->alloc_size(ptr)  :  foreign_usable_size(ptr);
+}
+
+}  // extern "C"
+
+void  * operator new(std::size_t  size)
+{
+  return  new_impl(size,  Malloc_Align);
+}
+
+void  * operator new[](std::size_t  size)
+{
+  return  new_impl(size,  Malloc_Align);
+}
+
+void  * operator new(std::size_t  size,  const std::nothrow_t  &)  noexcept
+{
+  return  new_nothrow(size,  Malloc_Align);
+}
+
+void  * operator new[](std::size_t  size,  const std::nothrow_t  &)  noexcept
+{
+  return  new_nothrow(size,  Malloc_Align);
+}
+
+void  * operator new(std::size_t  size,  std::align_val_t  alignment)
+{
+  return  new_impl(size,  static_cast<std::size_t>(alignment));
+}
+
+void  * operator new[](std::size_t  size,  std::align_val_t  alignment)
+{
+  return  new_impl(size,  static_cast<std::size_t>(alignment));
+}
+
+void  * operator new(std::size_t  size,  std::align_val_t  alignment,  const std::nothrow_t  &)  noexcept
+{
+  return  new_nothrow(size,  static_cast<std::size_t>(alignment));
+}
+
+void  * operator new[](std::size_t  size,  std::align_val_t  alignment,  const std::nothrow_t  &)  noexcept
+{
+  return  new_nothrow(size,  static_cast<std::size_t>(alignment));
+}
+
+void  operator delete(void  *ptr)  noexcept  {  preload_free(ptr);  }
+void  operator delete[](void  *ptr)  noexcept  {  preload_free(ptr);  }
+void  operator delete(void  *ptr,  const std::nothrow_t  &)  noexcept  {  preload_free(ptr);  }
+void  operator delete[](void  *ptr,  const std::nothrow_t  &)  noexcept  {  preload_free(ptr);  }
+void  operator delete(void  *ptr,  std::size_t)  noexcept  {  preload_free(ptr);  }
+void  operator delete[](void  *ptr,  std::size_t)  noexcept  {  preload_free(ptr);  }
+void  operator delete(void  *ptr,  std::align_val_t)  noexcept  {  preload_free(ptr);  }
+void  operator delete[](void  *ptr,  std::align_val_t)  noexcept  {  preload_free(ptr);  }
+void  operator delete(void  *ptr,  std::size_t,  std::align_val_t)  noexcept  {  preload_free(ptr);  }
+void  operator delete[](void  *ptr,  std::size_t,  std::align_val_t)  noexcept  {  preload_free(ptr);  }
+void  operator delete(void  *ptr,  std::align_val_t,  const std::nothrow_t  &)  noexcept  {  preload_free(ptr);  }
+void  operator delete[](void  *ptr,  std::align_val_t,  const std::nothrow_t  &)  noexcept  {  preload_free(ptr);  }
@@ -0,0 +1,86 @@
+#include "fast_mem_pool.h"
+#include <iostream>
+
+#if defined(DEF_Alloc_site)
+
+/**
+ * @brief test_alloc_site1
+ * @return
+ *  Testing per allocation site live bytes accounting (DEF_Alloc_site)
+ */
+bool test_alloc_site1()
+{
+  FastMemPool<10000, 4, 100>  memPool;
+  void  *a[10];
+  void  *b[5];
+  for (int i = 0; i < 10; ++i) {
+    a[i]  =  memPool.fmalloc_site(100, FMALLOC_SITE_ID());
+  }
+  for (int i = 0; i < 5; ++i) {
+    b[i]  =  memPool.fmalloc_site(300, FMALLOC_SITE_ID());
+  }
+  // free half of the first site:
+  for (int i = 0; i < 5; ++i) {
+    memPool.ffree(a[i]);
+  }
+
+  auto  stat  =  memPool.dump_live_by_site();
+  bool  re  =  2 == stat.size()
+      &&  1500 == stat[0].live_bytes  &&  5 == stat[0].live_cnt
+      &&  500 == stat[1].live_bytes  &&  5 == stat[1].live_cnt
+      &&  stat[0].file  &&  stat[1].file
+      &&  stat[0].line  >  stat[1].line;
+  if (!re)
+  {
+    for (auto &&it : stat)
+    {
+      std::cerr << "test_alloc_site1: " << (it.file ? it.file : "unknown") << ":" << it.line
+                << " live_bytes=" << it.live_bytes << " live_cnt=" << it.live_cnt << std::endl;
+    }
+  }
+
+  for (int i = 5; i < 10; ++i) {
+    memPool.ffree(a[i]);
+  }
+  for (int i = 0; i < 5; ++i) {
+    memPool.ffree(b[i]);
+  }
+  re  =  re  &&  memPool.dump_live_by_site().empty();
+  if (!re)  {  return  re;  }
+
+  // the leaves that are not cut by fmalloc itself are walked too:
+  FastMemPool<65536, 4, 1024>  leafPool;
+  auto  live_cnt  =  [&leafPool]()  {
+    int  cnt  =  0;
+    for (auto  &&it  :  leafPool.dump_live_by_site())  {  cnt  +=  it.live_cnt;  }
+    return  cnt;
+  };
+  // (DEF_Rseq_slots) these come from the per-CPU chunks, above DEF_Headerless_small:
+  void  *slot_alloc[10];
+  for (auto  &&it  :  slot_alloc)  {  it  =  leafPool.fmalloc_site(300,  FMALLOC_SITE_ID());  }
+  re  =  10  ==  live_cnt();
+  for (auto  &&it  :  slot_alloc)  {  leafPool.ffree(it);  }
+  re  =  re  &&  0  ==  live_cnt();
+  {  // a ScopedArena leaf looks depleted, it is walked from the arena cursor:
+    FastMemPool<65536, 4, 1024>::ScopedArena  arena(&leafPool);
+    void  *arena_alloc[10];
+    for (auto  &&it  :  arena_alloc)  {  it  =  arena.fmalloc(300);  }
+    leafPool.ffree(arena_alloc[3]);
+    re  =  re  &&  9  ==  live_cnt();
+  }
+  re  =  re  &&  0  ==  live_cnt();
+  // the epoch leaves too, the current one from the slot cursor, the passed one from its last cursor:
+  void  *epoch_alloc[300];
+  for (auto  &&it  :  epoch_alloc)  {  it  =  leafPool.fmalloc_epoch(300,  7);  }
+  leafPool.ffree(epoch_alloc[0]);
+  leafPool.ffree(epoch_alloc[299]);
+  re  =  re  &&  298  ==  live_cnt();
+  leafPool.free_epoch(7);
+  re  =  re  &&  0  ==  live_cnt();
+  if (!re)
+  {
+    std::cerr << "test_alloc_site1: leaf walk found " << live_cnt() << " allocations" << std::endl;
+  }
+  return  re;
+}
+#endif // DEF_Alloc_site
@@ -0,0 +1,34 @@
+#include "fast_mem_pool.h"
+#include <iostream>
+
+#if defined(DEF_Alloc_trace)
+/**
+ * @brief test_alloc_trace1
+ * @return
+ *  Testing fmalloc/ffree event tracer (DEF_Alloc_trace):
+ *  leaf rotations and OS malloc fallbacks (leaf -1) must be visible in the trace
+ */
+bool test_alloc_trace1()
+{
+  FastMemPool<1000, 2, 100>  memPool;
+  void  *ptr[30];
+  // 2 leaves of 1000 bytes can't hold 30 * (100 + header), the rest goes to OS malloc:
+  for (int i = 0; i < 30; ++i) {
+    ptr[i]  =  memPool.fmalloc(100);
+  }
+  for (int i = 0; i < 30; ++i) {
+    memPool.ffree(ptr[i]);
+  }
+  const std::string  json  =  fast_mem_pool_tracer.chrome_trace_json();
+  bool  re  =  0 == json.find("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[")
+      &&  std::string::npos != json.find("\"name\":\"fmalloc\",\"cat\":\"os\"")
+      &&  std::string::npos != json.find("\"leaf\":-1,\"path\":\"os\"")
+      &&  std::string::npos != json.find("\"name\":\"fmalloc\",\"cat\":\"leaf_rotate\"")
+      &&  std::string::npos != json.find("\"name\":\"ffree\",\"cat\":\"leaf_reset\"");
+  if (!re)
+  {
+    std::cerr << "test_alloc_trace1: unexpected trace:\n" << json.substr(0, 2000) << std::endl;
+  }
+  return  re;
+}
+#endif // DEF_Alloc_trace
@@ -0,0 +1,65 @@
+#include "fast_mem_pool.h"
+#include <iostream>
+#include <vector>
+
+using  TArenaPool = FastMemPool<65536, 8, 1024, true, true>;
+
+/**
+ * @brief test_arena1
+ * @return
+ *  release_all() makes every leaf available without ffree of each allocation,
+ *  ScopedArena takes private leaves and gives them back reset at the end of the scope
+ */
+bool test_arena1()
+{
+  TArenaPool  *pool  =  new TArenaPool();
+  bool  re  =  true;
+  // release_all (~250 KiB, all in the leaves):
+  for (int  i  =  0;  i  <  500;  ++i)
+  {
+    if (!pool->fmalloc(rand()  %  1000  +  1))  {  re  =  false;  }
+  }
+  pool->release_all();
+  const int  free_after_release  =  pool->get_free_leaves();
+
+  // ScopedArena:
+  int  arena_leaves  =  0;
+  int  free_in_scope  =  0;
+  void  *shared  =  pool->fmalloc(100);
+  {
+    TArenaPool::ScopedArena  arena(pool);
+    std::vector<char  *>  objs;
+    for (int  i  =  0;  i  <  2000;  ++i)
+    {
+      char  *obj  =  static_cast<char  *>(arena.fmalloc(100));
+      if (!obj  ||  !pool->owns(obj)  ||  !pool->check_access(obj,  obj  +  99,  1))  {  re  =  false;  break;  }
+      memset(obj,  1,  100);
+      objs.push_back(obj);
+    }
+    // one ffree is allowed, a too big allocation goes to the pool:
+    pool->ffree(objs.back());
+    char  *big  =  static_cast<char  *>(arena.fmalloc(100000));
+    if (!big  ||  pool->owns(big))  {  re  =  false;  }
+    // the other users of the pool do not get the arena leaves:
+    char  *outside  =  static_cast<char  *>(pool->fmalloc(100));
+    for (auto  &&it  :  objs)
+    {
+      if (outside  ==  it)  {  re  =  false;  }
+    }
+    pool->ffree(outside);
+    arena_leaves  =  arena.get_leaves();
+    free_in_scope  =  pool->get_free_leaves();
+  }
+  pool->ffree(shared);
+  pool->release_cpu_slots();
+  const int  free_leaves  =  pool->get_free_leaves();
+  delete  pool;
+  if (!re  ||  8  !=  free_after_release  ||  arena_leaves  <  3  ||  free_in_scope  >  8  -  arena_leaves
+      ||  8  !=  free_leaves)
+  {
+    std::cerr << "test_arena1: leaves lost, after release_all " << free_after_release
+              << ", arena leaves " << arena_leaves << ", free leaves=" << free_leaves << std::endl;
+    return  false;
+  }
+  return  true;
+}
@@ -0,0 +1,87 @@
+#include "fast_mem_pool.h"
+#include <iostream>
+
+using  TMarkPool = FastMemPool<65536, 8, 1024, true, true>;
+
+/**
+ * @brief test_arena_mark1
+ * @return
+ *  ScopedArena mark()/rollback(): the allocations after the mark are freed (the place is taken again,
+ *  the leaves claimed after the mark go back to the pool), the mark stays valid for the next rollback,
+ *  stale and foreign marks are rejected,
+ *  so is the ffree of an allocation that was taken back
+ */
+bool test_arena_mark1()
+{
+  TMarkPool  *pool  =  new TMarkPool();
+  bool  re  =  true;
+  int  leaves_in_scope  =  0;
+  {
+    TMarkPool::ScopedArena  arena(pool);
+    TMarkPool::ScopedArena  other(pool);
+    char  *keep  =  static_cast<char  *>(arena.fmalloc(100));
+    const TMarkPool::ScopedArena::Mark  outer  =  arena.mark();
+    char  *first  =  static_cast<char  *>(arena.fmalloc(200));
+    // backtracking: nested mark, more than one leaf after it
+    const TMarkPool::ScopedArena::Mark  inner  =  arena.mark();
+    for (int  i  =  0;  i  <  2000;  ++i)
+    {
+      if (!arena.fmalloc(100))  {  re  =  false;  }
+    }
+    const int  leaves_before  =  arena.get_leaves();
+    pool->ffree(first);
+    if (!arena.rollback(inner)  ||  1  !=  arena.get_leaves()  ||  leaves_before  <  3)  {  re  =  false;  }
+    // the place after the inner mark is taken again:
+    const std::size_t  header  =  pool->get_header_size();
+    char  *late  =  static_cast<char  *>(arena.fmalloc(100));
+    if (late  !=  first  -  100  -  header)  {  re  =  false;  }
+    // backtracking to inner again, the mark after it becomes stale:
+    const TMarkPool::ScopedArena::Mark  deeper  =  arena.mark();
+    if (!arena.fmalloc(300)  ||  !arena.rollback(inner))  {  re  =  false;  }
+    late  =  static_cast<char  *>(arena.fmalloc(100));
+    if (late  !=  first  -  100  -  header)  {  re  =  false;  }
+    // a stale mark and a mark of the other arena are rejected, outer is still valid:
+    bool  rejected_deeper  =  false;
+    bool  rejected_other  =  false;
+    try  {
+      rejected_deeper  =  !arena.rollback(deeper);
+    }  catch (std::range_error  &)  {
+      rejected_deeper  =  true;
+    }
+    try  {
+      rejected_other  =  !arena.rollback(other.mark());
+    }  catch (std::range_error  &)  {
+      rejected_other  =  true;
+    }
+    if (!rejected_deeper  ||  !rejected_other  ||  !arena.rollback(outer))  {  re  =  false;  }
+    // inner is after outer, stale now:
+    bool  rejected_inner  =  false;
+    try  {
+      rejected_inner  =  !arena.rollback(inner);
+    }  catch (std::range_error  &)  {
+      rejected_inner  =  true;
+    }
+    if (!rejected_inner)  {  re  =  false;  }
+    // an allocation after the mark can not be freed after the rollback:
+    bool  rejected_late  =  false;
+    try  {
+      pool->ffree(late);
+    }  catch (std::range_error  &)  {
+      rejected_late  =  true;
+    }
+    if (!rejected_late)  {  re  =  false;  }
+    if (static_cast<char  *>(arena.fmalloc(200))  !=  first)  {  re  =  false;  }
+    if (!pool->check_access(keep,  keep  +  99,  1))  {  re  =  false;  }
+    leaves_in_scope  =  pool->get_free_leaves();
+  }
+  pool->release_cpu_slots();
+  const int  free_leaves  =  pool->get_free_leaves();
+  delete  pool;
+  if (!re  ||  7  !=  leaves_in_scope  ||  8  !=  free_leaves)
+  {
+    std::cerr << "test_arena_mark1: rollback failed, free leaves in scope " << leaves_in_scope
+              << ", free leaves=" << free_leaves << std::endl;
+    return  false;
+  }
+  return  true;
+}
@@ -0,0 +1,72 @@
+#include "fast_mem_pool.h"
+#include <iostream>
+#include <vector>
+
+using  TAtLeastPool = FastMemPool<65536, 4, 1024, true, true>;
+
+/**
+ * @brief test_at_least1
+ * @return
+ *  fmalloc_at_least/allocate_at_least give at least the asked size, the whole actual size
+ *  is accessible (check_access), a buffer grown with allocate_at_least reallocates less often,
+ *  after ffree all leaves are free again
+ */
+bool test_at_least1()
+{
+  TAtLeastPool  *pool  =  new TAtLeastPool();
+  FastMemPoolAllocator<char,  TAtLeastPool>  alloc(pool);
+  bool  re  =  true;
+  std::vector<std::pair<char  *,  std::size_t>>  allocs;
+  for (std::size_t  size  =  1;  size  <  3000;  size  +=  97)
+  {
+    std::size_t  actual  =  0;
+    char  *ptr  =  static_cast<char  *>(pool->fmalloc_at_least(size,  &actual));
+    if (!ptr  ||  actual  <  size
+        ||  !FCHECK_ACCESS(pool,  ptr,  ptr  +  actual  -  1,  1))  {  re  =  false;  break;  }
+    memset(ptr,  1,  actual);
+    allocs.emplace_back(ptr,  actual);
+  }
+  // (not FFREE: in Debug builds FFREE knows only the FMALLOC allocations)
+  for (auto  &&it  :  allocs)  {  pool->ffree(it.first);  }
+
+  // growing buffer: exact allocate against allocate_at_least
+  int  exact_reallocs  =  0;
+  int  at_least_reallocs  =  0;
+  std::size_t  exact_cap  =  0;
+  std::size_t  at_least_cap  =  0;
+  char  *exact_buf  =  nullptr;
+  char  *at_least_buf  =  nullptr;
+  for (std::size_t  len  =  1;  len  <  20000;  len  +=  100)
+  {
+    if (len  >  exact_cap)
+    {
+      if (exact_buf)  {  alloc.deallocate(exact_buf,  exact_cap);  }
+      exact_cap  =  len  +  len  /  4;
+      exact_buf  =  alloc.allocate(exact_cap);
+      ++exact_reallocs;
+    }
+    if (len  >  at_least_cap)
+    {
+      if (at_least_buf)  {  alloc.deallocate(at_least_buf,  at_least_cap);  }
+      auto  result  =  alloc.allocate_at_least(len  +  len  /  4);
+      at_least_buf  =  result.ptr;
+      at_least_cap  =  result.count;
+      ++at_least_reallocs;
+      if (at_least_cap  <  len  +  len  /  4)  {  re  =  false;  }
+    }
+    memset(at_least_buf,  2,  len);
+  }
+  alloc.deallocate(exact_buf,  exact_cap);
+  alloc.deallocate(at_least_buf,  at_least_cap);
+  // (DEF_Rseq_slots) the per-CPU chunks go back to the leaves:
+  pool->release_cpu_slots();
+  const int  free_leaves  =  pool->get_free_leaves();
+  delete  pool;
+  if (!re  ||  at_least_reallocs  >  exact_reallocs  ||  4  !=  free_leaves)
+  {
+    std::cerr << "test_at_least1: actual size below the asked one or leaves lost, reallocs "
+              << at_least_reallocs << "/" << exact_reallocs << ", free leaves=" << free_leaves << std::endl;
+    return  false;
+  }
+  return  true;
+}
@@ -0,0 +1,79 @@
+#include "fast_mem_pool.h"
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#if defined(DEF_Buddy_medium)
+using  TBuddyPool = FastMemPool<65536, 4, 1024, false, true>;
+
+/**
+ * @brief test_buddy1
+ * @return
+ *  Testing the buddy leaves (DEF_Buddy_medium): 16 blocks of 4 KiB split one leaf,
+ *  check_access keeps the bounds of a block, a freed block is reused at once,
+ *  fmalloc_at_least gives the whole block, the other thread splits and merges while the
+ *  blocks are freed, after ffree the blocks coalesce and every leaf is back in the pool
+ */
+bool test_buddy1()
+{
+  TBuddyPool  *pool  =  new TBuddyPool();
+  bool  re  =  true;
+  const std::size_t  block  =  4096  -  TBuddyPool::get_header_size();
+  std::vector<char  *>  frames;
+  for (int  i  =  0;  i  <  16;  ++i)
+  {
+    char  *ptr  =  static_cast<char  *>(pool->fmalloc(block));
+    if (!ptr)  {  re  =  false;  break;  }
+    memset(ptr,  i,  block);
+    frames.push_back(ptr);
+  }
+  if (re)
+  {
+    re  =  pool->check_access(frames[3],  frames[3]  +  block  -  8,  8);
+    try  {
+      pool->check_access(frames[3],  frames[3]  +  block  -  8,  16);
+      re  =  false;
+    }  catch (const std::range_error  &)  {
+    }
+    // the freed block is the next one of its size:
+    char  *freed  =  frames[5];
+    pool->ffree(freed);
+    frames[5]  =  static_cast<char  *>(pool->fmalloc(block));
+    re  =  re  &&  freed  ==  frames[5];
+    for (int  i  =  0;  i  <  16;  ++i)
+    {
+      if (5  !=  i  &&  static_cast<char>(i)  !=  frames[i][block  -  1])  {  re  =  false;  }
+    }
+    std::size_t  actual  =  0;
+    char  *grown  =  static_cast<char  *>(pool->fmalloc_at_least(9000,  &actual));
+    re  =  re  &&  grown  &&  16384  -  TBuddyPool::get_header_size()  ==  actual
+        &&  pool->check_access(grown,  grown  +  actual  -  1,  1);
+    if (grown)  {  pool->ffree(grown);  }
+  }
+  // the other thread splits and merges the blocks while these are freed:
+  std::thread  other([pool]()  {
+    std::vector<char  *>  bufs;
+    for (int  i  =  0;  i  <  200;  ++i)
+    {
+      char  *ptr  =  static_cast<char  *>(pool->fmalloc(5000  +  (i  *  997)  %  20000));
+      if (ptr)  {  bufs.push_back(ptr);  }
+      if (bufs.size()  >  3)
+      {
+        pool->ffree(bufs.front());
+        bufs.erase(bufs.begin());
+      }
+    }
+    for (auto  &&it  :  bufs)  {  pool->ffree(it);  }
+  });
+  for (auto  &&it  :  frames)  {  if (it)  {  pool->ffree(it);  }  }
+  other.join();
+  re  =  re  &&  0  ==  pool->get_buddy_leaves()  &&  4  ==  pool->get_free_leaves();
+  if (!re)
+  {
+    std::cerr << "test_buddy1: failed, buddy leaves " << pool->get_buddy_leaves()
+              << ", free leaves " << pool->get_free_leaves() << std::endl;
+  }
+  delete  pool;
+  return  re;
+}
+#endif // DEF_Buddy_medium
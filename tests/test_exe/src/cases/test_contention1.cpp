@@ -0,0 +1,32 @@
+#include "fast_mem_pool.h"
+#include <iostream>
+
+#if defined(DEF_Contention_profile)
+/**
+ * @brief test_contention1
+ * @return
+ *  Testing contention profile (DEF_Contention_profile):
+ *  depleting the leaves must show up as cur_leaf stores, long scans and OS fallbacks
+ */
+bool test_contention1()
+{
+  FastMemPool<1000, 2, 100>  memPool;
+  void  *ptr[30];
+  for (int i = 0; i < 30; ++i) {
+    ptr[i]  =  memPool.fmalloc(100);
+  }
+  for (int i = 0; i < 30; ++i) {
+    memPool.ffree(ptr[i]);
+  }
+  const std::string  report  =  memPool.contention_report();
+  // header + columns + 2 leaves:
+  bool  re  =  0 == report.find("FastMemPool contention:")
+      &&  4 == std::count(report.begin(), report.end(), '\n')
+      &&  std::string::npos != report.find('@');
+  if (!re)
+  {
+    std::cerr << "test_contention1: unexpected report:\n" << report << std::endl;
+  }
+  return  re;
+}
+#endif // DEF_Contention_profile
@@ -0,0 +1,71 @@
+#include "fast_mem_pool.h"
+#include <iostream>
+#include <vector>
+
+using  TEpochPool = FastMemPool<65536, 8, 1024, true, true>;
+
+/**
+ * @brief test_epoch1
+ * @return
+ *  fmalloc_epoch puts the epochs in their own leaves, free_epoch recycles the leaves
+ *  of one epoch and leaves the other epoch and the usual allocations alone
+ */
+bool test_epoch1()
+{
+  TEpochPool  *pool  =  new TEpochPool();
+  bool  re  =  true;
+  void  *shared  =  pool->fmalloc(100);
+  std::vector<char  *>  first;
+  std::vector<char  *>  second;
+  // ~100 KiB in each epoch: two leaves at least
+  for (int  i  =  0;  i  <  1000;  ++i)
+  {
+    char  *a  =  static_cast<char  *>(pool->fmalloc_epoch(100,  1));
+    char  *b  =  static_cast<char  *>(pool->fmalloc_epoch(100,  2));
+    if (!a  ||  !b  ||  !pool->check_access(a,  a  +  99,  1)  ||  !pool->check_access(b,  b  +  99,  1))
+    {
+      re  =  false;
+      break;
+    }
+    memset(a,  1,  100);
+    memset(b,  2,  100);
+    first.push_back(a);
+    second.push_back(b);
+  }
+  // ffree of an epoch allocation is allowed:
+  pool->ffree(first.back());
+  first.pop_back();
+  const int  free_with_epochs  =  pool->get_free_leaves();
+  // the usual allocations do not get the epoch leaves:
+  char  *outside  =  static_cast<char  *>(pool->fmalloc(100));
+  for (auto  &&it  :  first)
+  {
+    if (outside  ==  it)  {  re  =  false;  }
+  }
+  pool->ffree(outside);
+  // too big for a leaf:
+  try {
+    pool->fmalloc_epoch(100000,  1);
+    re  =  false;
+  }  catch (const std::range_error  &)  {  }
+
+  if (!pool->free_epoch(1)  ||  pool->free_epoch(1))  {  re  =  false;  }
+  const int  free_after_first  =  pool->get_free_leaves();
+  // the second epoch is untouched:
+  for (auto  &&it  :  second)
+  {
+    if (2  !=  *it  ||  2  !=  it[99])  {  re  =  false;  break;  }
+  }
+  pool->free_epoch(2);
+  pool->ffree(shared);
+  pool->release_cpu_slots();
+  const int  free_leaves  =  pool->get_free_leaves();
+  delete  pool;
+  if (!re  ||  free_with_epochs  >  4  ||  free_after_first  <=  free_with_epochs  ||  8  !=  free_leaves)
+  {
+    std::cerr << "test_epoch1: leaves lost, with epochs " << free_with_epochs
+              << ", after free_epoch(1) " << free_after_first << ", free leaves=" << free_leaves << std::endl;
+    return  false;
+  }
+  return  true;
+}
@@ -0,0 +1,64 @@
+#include "fast_mem_pool.h"
+#include <iostream>
+
+#if defined(DEF_Headerless_small)
+/**
+ * @brief test_headerless1
+ * @return
+ *  Testing headerless small allocations (DEF_Headerless_small):
+ *  32 byte objects are packed without AllocHeader, ffree/check_access still control them
+ */
+bool test_headerless1()
+{
+  FastMemPool<65536, 4, 1024, false, true>  memPool;
+  char  *ptr[1000];
+  for (int i = 0; i < 1000; ++i) {
+    ptr[i]  =  static_cast<char *>(memPool.fmalloc(32));
+  }
+  // objects go one after another, 32 bytes each (48 with AllocHeader):
+  bool  re  =  true;
+  for (int i = 1; i < 1000 && re; ++i) {
+    re  =  ptr[i - 1]  +  32  ==  ptr[i];
+  }
+  re  =  re  &&  memPool.check_access(ptr[7], ptr[7] + 16, 16);
+  try {
+    memPool.check_access(ptr[7], ptr[7] + 16, 17);
+    re  =  false;
+  } catch (const std::range_error &) { }
+  // the requested size is controlled, not the size class:
+  char  *odd  =  static_cast<char *>(memPool.fmalloc(20));
+  re  =  re  &&  memPool.check_access(odd, odd + 16, 4);
+  try {
+    memPool.check_access(odd, odd + 16, 5);
+    re  =  false;
+  } catch (const std::range_error &) { }
+  // live objects are counted by their bitmaps:
+  re  =  re  &&  1001  ==  memPool.get_small_live()  &&  1001  ==  memPool.get_small_live(32);
+  memPool.ffree(odd);
+  try {  // not the start of an object:
+    memPool.ffree(ptr[7] + 8);
+    re  =  false;
+  } catch (const std::range_error &) { }
+  memPool.ffree(ptr[7]);
+  try {  // double free:
+    memPool.ffree(ptr[7]);
+    re  =  false;
+  } catch (const std::range_error &) { }
+  // a returned object is used again:
+  re  =  re  &&  ptr[7]  ==  memPool.fmalloc(30);
+  // bigger allocations still have AllocHeader:
+  char  *big  =  static_cast<char *>(memPool.fmalloc(1000));
+  re  =  re  &&  big  &&  memPool.check_access(big, big + 999, 1);
+  memPool.ffree(big);
+  for (int i = 0; i < 1000; ++i) {
+    memPool.ffree(ptr[i]);
+  }
+  memPool.release_cpu_slots();
+  re  =  re  &&  4  ==  memPool.get_free_leaves();
+  if (!re)
+  {
+    std::cerr << "test_headerless1: failed" << std::endl;
+  }
+  return  re;
+}
+#endif // DEF_Headerless_small
@@ -0,0 +1,62 @@
+#include "fast_mem_pool.h"
+#include <iostream>
+#include <vector>
+
+#if defined(DEF_Heap_profile)
+/**
+ * @brief test_heap_profile1
+ * @return
+ *  Testing the sampling heap profiler (DEF_Heap_profile), ffree of an unsampled pointer
+ *  stops after DEF_Heap_profile_Probe slots when the table is full of tombstones
+ */
+bool test_heap_profile1()
+{
+  FastMemPool<10000, 4, 100>  memPool;
+  const int64_t  rate  =  fast_mem_pool_profiler.get_sample_rate();
+  // sample each allocation:
+  fast_mem_pool_profiler.set_sample_rate(1);
+  void  *ptr[10];
+  for (int i = 0; i < 10; ++i) {
+    ptr[i]  =  memPool.fmalloc(123);
+  }
+  fast_mem_pool_profiler.set_sample_rate(rate);
+
+  // (other threads may change the rate meanwhile, but the first allocation is sampled anyway)
+  bool  re  =  fast_mem_pool_profiler.get_live_cnt()  >  0;
+  const std::string  profile  =  fast_mem_pool_profiler.heap_profile();
+  re  =  re  &&  0 == profile.find("heap profile: ")
+      &&  std::string::npos != profile.find("] @ heap_v2/")
+      &&  std::string::npos != profile.find("\nMAPPED_LIBRARIES:\n");
+  if (!re)
+  {
+    std::cerr << "test_heap_profile1: live_cnt=" << fast_mem_pool_profiler.get_live_cnt() << std::endl;
+  }
+
+  for (int i = 0; i < 10; ++i) {
+    memPool.ffree(ptr[i]);
+  }
+  if (!re)  {  return  re;  }
+
+  // more samples than slots come and go, the tombstones do not make ffree probe the whole table:
+  FastMemPoolProfiler  *profiler  =  new FastMemPoolProfiler();
+  profiler->set_sample_rate(1);
+  std::vector<char>  heap(4  *  DEF_Heap_profile_Slots  *  16);
+  for (int  round  =  0;  round  <  4;  ++round)
+  {
+    for (int  i  =  0;  i  <  DEF_Heap_profile_Slots;  ++i)  {  profiler->on_alloc(&heap[(round  *  DEF_Heap_profile_Slots  +  i)  *  16],  16);  }
+    for (int  i  =  0;  i  <  DEF_Heap_profile_Slots;  ++i)  {  profiler->on_free(&heap[(round  *  DEF_Heap_profile_Slots  +  i)  *  16]);  }
+  }
+  // (one sample stays alive, or the unsampled ffree returns at once)
+  char  unsampled  =  0;
+  profiler->on_alloc(&heap[0],  16);
+  const int  probed  =  profiler->on_free(&unsampled);
+  re  =  1  ==  profiler->get_live_cnt()  &&  probed  <=  DEF_Heap_profile_Probe;
+  if (!re)
+  {
+    std::cerr << "test_heap_profile1: unsampled ffree probed " << probed << " slots, live_cnt="
+              << profiler->get_live_cnt() << std::endl;
+  }
+  delete  profiler;
+  return  re;
+}
+#endif // DEF_Heap_profile
@@ -0,0 +1,43 @@
+#include "fast_mem_pool.h"
+#include <iostream>
+
+#if defined(DEF_Leaf_mmap)
+/**
+ * @brief test_leaf_mmap1
+ * @return
+ *  Testing all leaves in one mmap'ed range (DEF_Leaf_mmap):
+ *  allocations of the same leaf are neighbours, ffree/check_access recognize own allocations,
+ *  the leaves are reset and used again
+ */
+bool test_leaf_mmap1()
+{
+  FastMemPool<4096, 8, 256, false, false>  memPool;
+  char  *ptr[200];
+  int  cnt  =  0;
+  for (;  cnt  <  200;  ++cnt) {
+    ptr[cnt]  =  static_cast<char *>(memPool.fmalloc(300));
+    if (!ptr[cnt])  break;
+  }
+  // 8 leaves of 4096 bytes, 300 bytes + AllocHeader per allocation:
+  bool  re  =  8 * 12  ==  cnt;
+  // the leaf is cut from its end, allocations are neighbours:
+  re  =  re  &&  ptr[1]  <  ptr[0]  &&  ptr[0]  -  ptr[1]  ==  ptr[1]  -  ptr[2];
+  for (int i = 0; i < cnt && re; ++i) {
+    re  =  memPool.check_access(ptr[i], ptr[i] + 100, 100)
+        &&  !memPool.check_access(ptr[i], ptr[i] + 250, 100);
+  }
+  for (int i = 0; i < cnt; ++i) {
+    memPool.ffree(ptr[i]);
+  }
+  memPool.release_cpu_slots();
+  re  =  re  &&  8  ==  memPool.get_free_leaves();
+  void  *again  =  memPool.fmalloc(300);
+  re  =  re  &&  again;
+  memPool.ffree(again);
+  if (!re)
+  {
+    std::cerr << "test_leaf_mmap1: failed, allocations=" << cnt << std::endl;
+  }
+  return  re;
+}
+#endif // DEF_Leaf_mmap
@@ -0,0 +1,59 @@
+#include "fast_mem_pool.h"
+#include <thread>
+#include <iostream>
+#include <vector>
+
+using  TRecoveryPool = FastMemPool<4096, 4, 256, false, false>;
+
+static void  churn(TRecoveryPool  *pool,  int  seed)
+{
+  void  *live[32]  =  {};
+  uint32_t  rnd  =  seed  *  2654435761u  +  1;
+  for (int  i  =  0;  i  <  200000;  ++i)
+  {
+    rnd  =  rnd  *  1103515245u  +  12345u;
+    const int  slot  =  (rnd  >>  16)  %  32;
+    if (live[slot])
+    {
+      pool->ffree(live[slot]);
+      live[slot]  =  nullptr;
+    } else {
+      // sizes near the leaf tail make the threads race for the last bytes of a leaf:
+      live[slot]  =  pool->fmalloc(16  +  (rnd  >>  8)  %  500);
+    }
+  }
+  for (auto  &&ptr  :  live)
+  {
+    if (ptr)  {  pool->ffree(ptr);  }
+  }
+}
+
+/**
+ * @brief test_leaf_recovery1
+ * @return
+ *  Threads race for the tails of tiny leaves (the pool depletes all the time),
+ *  after every allocation is returned each leaf must be reset and available again
+ */
+bool test_leaf_recovery1()
+{
+  TRecoveryPool  *pool  =  new TRecoveryPool();
+  std::vector<std::thread>  threads;
+  for (int  i  =  0;  i  <  8;  ++i)
+  {
+    threads.emplace_back(churn,  pool,  i);
+  }
+  for (auto  &&it  :  threads)
+  {
+    it.join();
+  }
+  // (DEF_Rseq_slots) the per-CPU chunks go back to the leaves:
+  pool->release_cpu_slots();
+  const int  free_leaves  =  pool->get_free_leaves();
+  delete pool;
+  if (4  !=  free_leaves)
+  {
+    std::cerr << "test_leaf_recovery1: leaves lost, free leaves=" << free_leaves << std::endl;
+    return  false;
+  }
+  return  true;
+}
@@ -0,0 +1,60 @@
+#include "fast_mem_pool.h"
+#include <iostream>
+#include <vector>
+
+#if defined(DEF_Lifetime_groups)
+using  TLifetimePool = FastMemPool<65536, 8, 1024, true, true>;
+
+/**
+ * @brief test_lifetime1
+ * @return
+ *  Long living objects allocated between short lived buffers go to the Long leaf group:
+ *  when the short ones are freed their leaves reset, the long ones pin at most a leaf per group
+ *  (sizes over the headerless and per-CPU slot ranges, those ignore the hint)
+ */
+bool test_lifetime1()
+{
+  TLifetimePool  *pool  =  new TLifetimePool();
+  bool  re  =  true;
+  std::vector<void  *>  short_lived;
+  std::vector<void  *>  long_lived;
+  for (int  i  =  0;  i  <  100;  ++i)
+  {
+    short_lived.push_back(pool->fmalloc(2000,  FastMemPoolLifetimeHint::Short));
+    if (0  ==  i  %  10)
+    {
+      long_lived.push_back(pool->fmalloc(1100,  FastMemPoolLifetimeHint::Long));
+    }
+  }
+  for (auto  &&it  :  short_lived)
+  {
+    if (!pool->owns(it))  {  re  =  false;  }
+    pool->ffree(it);
+  }
+  pool->release_cpu_slots();
+  const int  free_with_long  =  pool->get_free_leaves();
+
+  // the allocator keeps its hint through rebind:
+  using  TAllocator  =  FastMemPoolAllocator<int,  TLifetimePool>;
+  const TAllocator  short_allocator(pool,  FastMemPoolLifetimeHint::Short);
+  FastMemPoolAllocator<char,  TLifetimePool>  rebound(short_allocator);
+  re  =  re  &&  FastMemPoolLifetimeHint::Short  ==  rebound.hint  &&  rebound  ==  short_allocator;
+  {
+    std::vector<int,  TAllocator>  vec(short_allocator);
+    for (int  i  =  0;  i  <  1000;  ++i)  {  vec.push_back(i);  }
+    re  =  re  &&  pool->owns(vec.data())  &&  999  ==  vec.back();
+  }
+
+  for (auto  &&it  :  long_lived)  {  pool->ffree(it);  }
+  pool->release_cpu_slots();
+  const int  free_leaves  =  pool->get_free_leaves();
+  delete  pool;
+  if (!re  ||  free_with_long  <  6  ||  8  !=  free_leaves)
+  {
+    std::cerr << "test_lifetime1: long living objects pin the leaves, free leaves with them " << free_with_long
+              << ", free leaves=" << free_leaves << std::endl;
+    return  false;
+  }
+  return  true;
+}
+#endif
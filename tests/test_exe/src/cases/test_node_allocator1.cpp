@@ -0,0 +1,61 @@
+#include "fast_mem_pool.h"
+#include <iostream>
+#include <list>
+#include <map>
+#include <set>
+#include <unordered_map>
+
+using  TNodePool = FastMemPool<65536, 16, 1024, true, true>;
+template<class T>
+using  TNodeAllocator = FastMemPoolNodeAllocator<T,  TNodePool>;
+
+/**
+ * @brief test_node_allocator1
+ * @return
+ *  node containers on FastMemPoolNodeAllocator: the nodes land in the pool and are reused after erase,
+ *  copies of a container get their own cache, after the containers all leaves are free again
+ */
+bool test_node_allocator1()
+{
+  TNodePool  *pool  =  new TNodePool();
+  bool  re  =  true;
+  {
+    const TNodeAllocator<int>  alloc(pool);
+    std::map<int,  int,  std::less<int>,  TNodeAllocator<std::pair<const int,  int>>>  map1(alloc);
+    std::set<int,  std::less<int>,  TNodeAllocator<int>>  set1(alloc);
+    std::list<int,  TNodeAllocator<int>>  list1(alloc);
+    std::unordered_map<int,  int,  std::hash<int>,  std::equal_to<int>,  TNodeAllocator<std::pair<const int,  int>>>
+        umap1(16,  std::hash<int>(),  std::equal_to<int>(),  TNodeAllocator<std::pair<const int,  int>>(pool));
+    for (int  i  =  0;  i  <  500;  ++i)
+    {
+      map1.emplace(i,  i);
+      set1.insert(i);
+      list1.push_back(i);
+      umap1.emplace(i,  i);
+    }
+    // the erased nodes are taken again:
+    const void  *erased  =  &*set1.find(250);
+    set1.erase(250);
+    set1.insert(1000);
+    if (erased  !=  &*set1.find(1000))  {  re  =  false;  }
+    for (auto  &&it  :  map1)  {  if (it.first  !=  it.second  ||  !pool->owns(&it))  re  =  false;  }
+    for (auto  &&it  :  list1)  {  if (!pool->owns(&it))  re  =  false;  }
+    for (auto  &&it  :  umap1)  {  if (it.first  !=  it.second  ||  !pool->owns(&it))  re  =  false;  }
+    if (map1.get_allocator()  !=  alloc  ||  umap1.get_allocator()  ==  alloc)  {  re  =  false;  }
+
+    std::map<int,  int,  std::less<int>,  TNodeAllocator<std::pair<const int,  int>>>  map2(map1);
+    if (map2.size()  !=  map1.size()  ||  map2.get_allocator()  ==  map1.get_allocator())  {  re  =  false;  }
+    map2.swap(map1);
+    if (500  !=  map1.size())  {  re  =  false;  }
+  }
+  // (DEF_Rseq_slots) the per-CPU chunks go back to the leaves:
+  pool->release_cpu_slots();
+  const int  free_leaves  =  pool->get_free_leaves();
+  delete  pool;
+  if (!re  ||  16  !=  free_leaves)
+  {
+    std::cerr << "test_node_allocator1: nodes out of the pool or leaves lost, free leaves=" << free_leaves << std::endl;
+    return  false;
+  }
+  return  true;
+}
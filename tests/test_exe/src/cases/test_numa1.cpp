@@ -0,0 +1,57 @@
+#include "fast_mem_pool.h"
+#include <iostream>
+
+#if defined(DEF_NUMA)
+/**
+ * @brief test_numa1
+ * @return
+ *  Testing NUMA leaf groups:
+ *  the groups cover all leaves, a depleted node falls back to the other nodes
+ *  (counted as remote), then to OS malloc, every leaf comes back after ffree.
+ *  On a single node machine there is one group: the usual pool.
+ */
+bool test_numa1()
+{
+  using  TPool  =  FastMemPool<4096, 8, 256, false, false>;
+  bool  re  =  true;
+  for (FastMemPoolProvision  provision  :  {FastMemPoolProvision::Eager,  FastMemPoolProvision::Lazy})
+  {
+    TPool  pool(provision);
+    const int  nodes  =  pool.get_numa_nodes();
+    re  =  re  &&  nodes  >=  1  &&  nodes  <=  8;
+    void  *ptr[200];
+    int  cnt  =  0;
+    for (;  cnt  <  200;  ++cnt) {
+      ptr[cnt]  =  pool.fmalloc(1000);
+      if (!ptr[cnt])  break;
+    }
+    // 4 allocations of 1000 bytes + AllocHeader in each of 8 leaves (3 with the DEF_Alloc_site header), whatever the node:
+    re  =  re  &&  8 * (4096 / (1000 + static_cast<int>(TPool::get_header_size())))  ==  cnt;
+    std::vector<FastMemPoolNodeStat>  stats  =  pool.numa_stats();
+    int  leaves  =  0;
+    uint64_t  remote  =  0;
+    uint64_t  os  =  0;
+    for (auto  &&it  :  stats) {
+      leaves  +=  it.leaves;
+      remote  +=  it.remote_allocs;
+      os  +=  it.os_allocs;
+      re  =  re  &&  0  ==  it.free_leaves;
+    }
+    re  =  re  &&  nodes  ==  static_cast<int>(stats.size())  &&  8  ==  leaves;
+    // the last failed fmalloc went through every node:
+    re  =  re  &&  1  ==  os;
+    // the other nodes served the rest:
+    re  =  re  &&  (1  ==  nodes  ?  0  ==  remote  :  remote  >  0);
+    for (int i = 0; i < cnt; ++i) {
+      pool.ffree(ptr[i]);
+    }
+    pool.release_cpu_slots();
+    re  =  re  &&  8  ==  pool.get_free_leaves();
+  }
+  if (!re)
+  {
+    std::cerr << "test_numa1: failed" << std::endl;
+  }
+  return  re;
+}
+#endif // DEF_NUMA
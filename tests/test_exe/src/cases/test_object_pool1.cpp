@@ -0,0 +1,92 @@
+#include "fast_object_pool.h"
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using  TObjectMemPool = FastMemPool<65536, 16, 1024, true, true>;
+
+namespace {
+// constructors and destructors of the thread (the tests run in several threads at once):
+thread_local int  constructed  =  0;
+thread_local int  destructed  =  0;
+
+struct PoolObject {
+  PoolObject()  {  ++constructed;  }
+  PoolObject(int  in_id,  const char  *in_name)  :  id(in_id),  name(in_name)  {  ++constructed;  }
+  ~PoolObject()  {  ++destructed;  }
+  int  id  {  0  };
+  std::string  name  {  "the default name is longer than SSO"  };
+};
+}
+
+/**
+ * @brief test_object_pool1
+ * @return
+ *  FastObjectPool: two threads share a pool, the destroyed slots are taken again,
+ *  with Cache_Constructed the constructor runs once per slot and the destructor with the pool,
+ *  after the object pools all leaves are free again
+ */
+bool test_object_pool1()
+{
+  TObjectMemPool  *pool  =  new TObjectMemPool();
+  bool  re  =  true;
+  {
+    FastObjectPool<PoolObject,  TObjectMemPool>  objects(pool);
+    auto  worker  =  [&objects](int  base,  bool  *ok)  {
+      std::vector<PoolObject  *>  mine;
+      for (int  round  =  0;  round  <  10;  ++round)
+      {
+        for (int  i  =  0;  i  <  200;  ++i)  {  mine.push_back(objects.create(base  +  i,  "pool object name over SSO"));  }
+        for (int  i  =  0;  i  <  200;  ++i)
+        {
+          if (base  +  i  !=  mine[i]->id  ||  'p'  !=  mine[i]->name[0])  {  *ok  =  false;  }
+        }
+        for (auto  &&it  :  mine)  {  objects.destroy(it);  }
+        mine.clear();
+      }
+    };
+    bool  ok1  =  true;
+    bool  ok2  =  true;
+    std::thread  other(worker,  1000,  &ok2);
+    worker(0,  &ok1);
+    other.join();
+    re  =  ok1  &&  ok2;
+    // the last destroyed slot is the next one:
+    PoolObject  *first  =  objects.create();
+    objects.destroy(first);
+    if (first  !=  objects.create(1,  "a"))  {  re  =  false;  }
+    objects.destroy(first);
+  }
+  {
+    constructed  =  0;
+    destructed  =  0;
+    FastObjectPool<PoolObject,  TObjectMemPool,  true>  cached(pool);
+    std::vector<PoolObject  *>  objs;
+    for (int  round  =  0;  round  <  5;  ++round)
+    {
+      for (int  i  =  0;  i  <  100;  ++i)
+      {
+        objs.push_back(cached.create());
+        objs.back()->id  =  i;
+      }
+      for (auto  &&it  :  objs)  {  cached.destroy(it);  }
+      objs.clear();
+    }
+    // the state is kept by destroy:
+    PoolObject  *again  =  cached.create();
+    if (100  !=  constructed  ||  0  !=  destructed  ||  !pool->owns(again)  ||  again->name.empty())  {  re  =  false;  }
+    cached.destroy(again);
+  }
+  if (100  !=  destructed)  {  re  =  false;  }
+  pool->release_cpu_slots();
+  const int  free_leaves  =  pool->get_free_leaves();
+  delete  pool;
+  if (!re  ||  16  !=  free_leaves)
+  {
+    std::cerr << "test_object_pool1: objects lost, constructed " << constructed << ", destructed " << destructed
+              << ", free leaves=" << free_leaves << std::endl;
+    return  false;
+  }
+  return  true;
+}
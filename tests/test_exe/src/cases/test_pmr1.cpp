@@ -0,0 +1,103 @@
+#include "fast_mem_pool.h"
+#include <iostream>
+
+#if defined(FastMemPool_PMR)
+#include <vector>
+#include <unordered_map>
+#include <string>
+
+using  TPmrPool = FastMemPool<65536, 8, 1024, true, true>;
+// full leaves without OS malloc: the upstream resource serves
+using  TNoOSPmrPool = FastMemPool<4096, 2, 1024, false, true>;
+#endif // FastMemPool_PMR
+
+/**
+ * @brief test_pmr1
+ * @return
+ *  std::pmr containers over FastMemPoolResource: the allocations land in the pool
+ *  (aligned as asked between odd sized byte buffers, too big ones in OS malloc aligned too), after the containers all leaves are free again,
+ *  a pool without OS malloc passes what the leaves can not serve to the upstream resource
+ */
+bool test_pmr1()
+{
+#if defined(FastMemPool_PMR)
+  TPmrPool  *pool  =  new TPmrPool();
+  TPmrPool  *other_pool  =  new TPmrPool();
+  bool  re  =  true;
+  {
+    FastMemPoolResource<TPmrPool>  resource(pool);
+    FastMemPoolResource<TPmrPool>  same(pool);
+    FastMemPoolResource<TPmrPool>  other(other_pool);
+    if (!resource.is_equal(same)  ||  resource.is_equal(other)
+        ||  resource.is_equal(*std::pmr::new_delete_resource()))  {  re  =  false;  }
+
+    std::pmr::vector<int>  vec(&resource);
+    std::pmr::unordered_map<int,  std::pmr::string>  umap(&resource);
+    for (int  i  =  0;  i  <  1000;  ++i)
+    {
+      vec.push_back(i);
+      umap.emplace(i,  std::to_string(i)  +  " is long enough to leave the small string buffer");
+    }
+    if (!pool->owns(vec.data()))  {  re  =  false;  }
+    for (int  i  =  0;  i  <  1000;  ++i)
+    {
+      if (i  !=  vec[i]  ||  0  !=  umap[i].find(std::to_string(i)))  {  re  =  false;  }
+    }
+
+    // the default alignment between odd sized byte buffers, odd sizes of a smaller alignment:
+    std::vector<void  *>  bytes,  words,  ints;
+    for (int  i  =  0;  i  <  50;  ++i)
+    {
+      bytes.push_back(resource.allocate(1  +  i  %  13,  1));
+      words.push_back(resource.allocate(24));
+      ints.push_back(resource.allocate(4  *  (1  +  i  %  5),  4));
+      if (reinterpret_cast<uintptr_t>(words.back())  %  alignof(std::max_align_t)
+          ||  reinterpret_cast<uintptr_t>(ints.back())  %  4
+          ||  !pool->owns(words.back())  ||  !pool->owns(ints.back()))  {  re  =  false;  }
+    }
+    for (int  i  =  0;  i  <  50;  ++i)
+    {
+      resource.deallocate(bytes[i],  1  +  i  %  13,  1);
+      resource.deallocate(words[i],  24);
+      resource.deallocate(ints[i],  4  *  (1  +  i  %  5),  4);
+    }
+
+    void  *line  =  resource.allocate(100,  64);
+    void  *big  =  resource.allocate(100000);
+    void  *big_line  =  resource.allocate(100000,  64);
+    if (reinterpret_cast<uintptr_t>(line)  %  64  ||  !pool->owns(line)  ||  pool->owns(big)
+        ||  reinterpret_cast<uintptr_t>(big_line)  %  64  ||  pool->owns(big_line))  {  re  =  false;  }
+    resource.deallocate(big_line,  100000,  64);
+    resource.deallocate(big,  100000);
+    resource.deallocate(line,  100,  64);
+  }
+  // (DEF_Rseq_slots) the per-CPU chunks go back to the leaves:
+  pool->release_cpu_slots();
+  const int  free_leaves  =  pool->get_free_leaves();
+  delete  other_pool;
+  delete  pool;
+
+  TNoOSPmrPool  *no_os_pool  =  new TNoOSPmrPool();
+  {
+    FastMemPoolResource<TNoOSPmrPool>  no_os(no_os_pool);
+    std::vector<void  *>  spills;
+    int  spilled  =  0;
+    for (int  i  =  0;  i  <  40;  ++i)
+    {
+      spills.push_back(no_os.allocate(300));
+      if (!no_os_pool->owns(spills.back()))  {  ++spilled;  }
+    }
+    for (auto  &&it  :  spills)  {  no_os.deallocate(it,  300);  }
+    if (0  ==  spilled)  {  re  =  false;  }
+  }
+  no_os_pool->release_cpu_slots();
+  if (2  !=  no_os_pool->get_free_leaves())  {  re  =  false;  }
+  delete  no_os_pool;
+  if (!re  ||  8  !=  free_leaves)
+  {
+    std::cerr << "test_pmr1: allocations out of the pool or leaves lost, free leaves=" << free_leaves << std::endl;
+    return  false;
+  }
+#endif // FastMemPool_PMR
+  return  true;
+}
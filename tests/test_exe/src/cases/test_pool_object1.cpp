@@ -0,0 +1,134 @@
+#include "fast_mem_pool.h"
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using  TObjectPool = FastMemPool<65536, 8, 1024, true, true>;
+
+struct Frame : public FastMemPoolObject<Frame, TObjectPool>  {
+  virtual ~Frame()  {}
+  int  id  {  0  };
+  char  data[200];
+};
+
+// derived class: bigger objects through the same operators, the sized delete gets sizeof(BigFrame)
+struct BigFrame : public Frame  {
+  char  extra[1000];
+};
+
+struct alignas(64) LineFrame : public FastMemPoolObject<LineFrame, TObjectPool>  {
+  char  data[100];
+};
+
+// two small leaves: the objects go on to OS malloc, or to std::bad_alloc without it
+using  TSmallPool = FastMemPool<4096, 2, 1024, true, true>;
+using  TNoOSPool = FastMemPool<4096, 2, 1024, false, true>;
+
+struct alignas(64) SpillFrame : public FastMemPoolObject<SpillFrame, TSmallPool>  {
+  char  data[300];
+};
+
+struct NoOSFrame : public FastMemPoolObject<NoOSFrame, TNoOSPool>  {
+  char  data[300];
+};
+
+/**
+ * @brief test_pool_object1
+ * @return
+ *  new/make_unique/new[]/nothrow new of FastMemPoolObject classes land in the injected pool,
+ *  aligned to __STDCPP_DEFAULT_NEW_ALIGNMENT__ between odd sized allocations, over-aligned objects are aligned (the OS malloc fallback too), after every delete all leaves are free again,
+ *  a full pool without OS malloc throws std::bad_alloc
+ */
+bool test_pool_object1()
+{
+  // the classes have one pool pointer, the test threads take turns:
+  static std::mutex  mut;
+  std::lock_guard<std::mutex>  lg(mut);
+  TObjectPool  *pool  =  new TObjectPool();
+  Frame::set_fast_mem_pool(pool);
+  LineFrame::set_fast_mem_pool(pool);
+  bool  re  =  true;
+  {
+    std::vector<std::unique_ptr<Frame>>  frames;
+    std::vector<void  *>  odd;
+    for (int  i  =  0;  i  <  200;  ++i)
+    {
+      if (i  %  2)
+      {
+        frames.emplace_back(std::make_unique<BigFrame>());
+      }  else  {
+        frames.emplace_back(std::make_unique<Frame>());
+      }
+      frames.back()->id  =  i;
+      if (!pool->owns(frames.back().get())
+          ||  reinterpret_cast<uintptr_t>(frames.back().get())  %  __STDCPP_DEFAULT_NEW_ALIGNMENT__)  {  re  =  false;  }
+      // an odd sized allocation of the same pool in between:
+      odd.push_back(pool->fmalloc(1  +  i  %  13));
+    }
+    std::vector<LineFrame  *>  lines;
+    for (int  i  =  0;  i  <  50;  ++i)
+    {
+      lines.push_back(new LineFrame());
+      if (reinterpret_cast<uintptr_t>(lines.back())  %  64  ||  !pool->owns(lines.back()))  {  re  =  false;  }
+    }
+    Frame  *array  =  new Frame[10];
+    Frame  *nothrow  =  new (std::nothrow) Frame();
+    if (!pool->owns(array)  ||  !nothrow  ||  !pool->owns(nothrow))  {  re  =  false;  }
+    for (int  i  =  0;  i  <  200;  ++i)
+    {
+      if (i  !=  frames[i]->id)  {  re  =  false;  }
+    }
+    // (new[] of a class with a destructor puts the element count in front of the array)
+    if (reinterpret_cast<uintptr_t>(nothrow)  %  __STDCPP_DEFAULT_NEW_ALIGNMENT__)  {  re  =  false;  }
+    for (auto  &&it  :  odd)  {  pool->ffree(it);  }
+    delete  nothrow;
+    delete[]  array;
+    for (auto  &&it  :  lines)  {  delete  it;  }
+  }
+  // (DEF_Rseq_slots) the per-CPU chunks go back to the leaves:
+  pool->release_cpu_slots();
+  const int  free_leaves  =  pool->get_free_leaves();
+  Frame::set_fast_mem_pool(nullptr);
+  LineFrame::set_fast_mem_pool(nullptr);
+  delete pool;
+
+  TSmallPool  *small_pool  =  new TSmallPool();
+  SpillFrame::set_fast_mem_pool(small_pool);
+  std::vector<SpillFrame  *>  spills;
+  int  spilled  =  0;
+  for (int  i  =  0;  i  <  40;  ++i)
+  {
+    spills.push_back(new SpillFrame());
+    if (reinterpret_cast<uintptr_t>(spills.back())  %  64)  {  re  =  false;  }
+    if (!small_pool->owns(spills.back()))  {  ++spilled;  }
+  }
+  // (the sized delete frees the OS allocations without owns())
+  for (auto  &&it  :  spills)  {  delete  it;  }
+  small_pool->release_cpu_slots();
+  const int  small_free_leaves  =  small_pool->get_free_leaves();
+  SpillFrame::set_fast_mem_pool(nullptr);
+  delete small_pool;
+  if (0  ==  spilled  ||  2  !=  small_free_leaves)  {  re  =  false;  }
+
+  TNoOSPool  *no_os_pool  =  new TNoOSPool();
+  NoOSFrame::set_fast_mem_pool(no_os_pool);
+  std::vector<NoOSFrame  *>  no_os;
+  bool  bad_alloc  =  false;
+  try  {
+    for (int  i  =  0;  i  <  40;  ++i)  {  no_os.push_back(new NoOSFrame());  }
+  }  catch (const std::bad_alloc  &)  {
+    bad_alloc  =  true;
+  }
+  if (!bad_alloc  ||  nullptr  !=  new (std::nothrow) NoOSFrame())  {  re  =  false;  }
+  for (auto  &&it  :  no_os)  {  delete  it;  }
+  NoOSFrame::set_fast_mem_pool(nullptr);
+  delete no_os_pool;
+
+  if (!re  ||  8  !=  free_leaves)
+  {
+    std::cerr << "test_pool_object1: objects out of the pool or leaves lost, free leaves=" << free_leaves << std::endl;
+    return  false;
+  }
+  return  true;
+}
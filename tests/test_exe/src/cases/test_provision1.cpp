@@ -0,0 +1,45 @@
+#include "fast_mem_pool.h"
+#include <iostream>
+
+/**
+ * @brief test_provision1
+ * @return
+ *  Testing leaf provisioning policies:
+ *  Lazy starts without leaves and provisions them one by one as fmalloc needs them,
+ *  the other policies start with all leaves ready
+ */
+bool test_provision1()
+{
+  using  TPool  =  FastMemPool<4096, 8, 256, false, false>;
+  bool  re  =  true;
+  {
+    TPool  lazy_pool(FastMemPoolProvision::Lazy);
+    re  =  re  &&  0  ==  lazy_pool.get_free_leaves();
+    void  *ptr[200];
+    int  cnt  =  0;
+    for (;  cnt  <  200;  ++cnt) {
+      ptr[cnt]  =  lazy_pool.fmalloc(1000);
+      if (!ptr[cnt])  break;
+    }
+    // 4 allocations of 1000 bytes + AllocHeader in each of 8 leaves (3 with the DEF_Alloc_site header):
+    re  =  re  &&  8 * (4096 / (1000 + static_cast<int>(TPool::get_header_size())))  ==  cnt;
+    for (int i = 0; i < cnt; ++i) {
+      lazy_pool.ffree(ptr[i]);
+    }
+    lazy_pool.release_cpu_slots();
+    re  =  re  &&  8  ==  lazy_pool.get_free_leaves();
+  }
+  for (FastMemPoolProvision  provision  :  {FastMemPoolProvision::Eager,  FastMemPoolProvision::Prefault,  FastMemPoolProvision::Pretouch})
+  {
+    TPool  pool(provision,  2);
+    re  =  re  &&  8  ==  pool.get_free_leaves();
+    void  *ptr  =  pool.fmalloc(1000);
+    re  =  re  &&  ptr;
+    pool.ffree(ptr);
+  }
+  if (!re)
+  {
+    std::cerr << "test_provision1: failed" << std::endl;
+  }
+  return  re;
+}
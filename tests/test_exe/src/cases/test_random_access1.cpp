@@ -29,7 +29,7 @@ bool  test_random_access1()
     int  *array;
     int  array_size;
   };
-  std::vector<TestStruct>  vec_random_mem_chanks(0,  FastMemPoolAllocator<TestStruct>() ) ;
+  std::vector<TestStruct,  FastMemPoolAllocator<TestStruct>>  vec_random_mem_chanks(0,  FastMemPoolAllocator<TestStruct>() ) ;
   for (int  i =  1;  i  <  1000  && keep_run.load(std::memory_order_acquire);  ++i)
   {
     int  size  =  rand() % 1000 + 4;
@@ -0,0 +1,41 @@
+#include "fast_mem_pool.h"
+#include <iostream>
+
+#if defined(DEF_Pool_registry)
+/**
+ * @brief test_registry1
+ * @return
+ *  Testing the pool registry (DEF_Pool_registry):
+ *  allocations of pools with different template parameters and OS malloc fallbacks
+ *  are returned with fm_free(ptr) without the pool, foreign pointers are refused
+ */
+bool test_registry1()
+{
+  FastMemPool<4096, 4, 256, true, false>  pool_a;
+  FastMemPool<333, 33, 100, true, false>  pool_b;
+  bool  re  =  true;
+  void  *ptr[40];
+  for (int  i  =  0;  i  <  40;  ++i)
+  {
+    // the last allocations of pool_a go to OS malloc:
+    ptr[i]  =  (i  &  1)  ?  pool_b.fmalloc(50)  :  pool_a.fmalloc(1000);
+    re  =  re  &&  ptr[i];
+  }
+  for (int  i  =  0;  i  <  40;  ++i)
+  {
+    re  =  re  &&  fm_free(ptr[i]);
+  }
+  pool_a.release_cpu_slots();
+  pool_b.release_cpu_slots();
+  re  =  re  &&  4  ==  pool_a.get_free_leaves()  &&  33  ==  pool_b.get_free_leaves();
+  // not an allocation of any pool:
+  char  foreign[64]  =  {};
+  re  =  re  &&  !fm_free(foreign  +  32);
+  re  =  re  &&  fm_free(nullptr);
+  if (!re)
+  {
+    std::cerr << "test_registry1: failed" << std::endl;
+  }
+  return  re;
+}
+#endif // DEF_Pool_registry
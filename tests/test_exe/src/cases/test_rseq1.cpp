@@ -0,0 +1,74 @@
+#include "fast_mem_pool.h"
+#include <thread>
+#include <iostream>
+#include <vector>
+
+#if defined(DEF_Rseq_slots)
+using  TRseqPool = FastMemPool<65536, 8, 1024, false, false>;
+
+static void  slot_churn(TRseqPool  *pool,  int  seed)
+{
+  void  *live[64]  =  {};
+  uint32_t  rnd  =  seed  *  2654435761u  +  1;
+  for (int  i  =  0;  i  <  100000;  ++i)
+  {
+    rnd  =  rnd  *  1103515245u  +  12345u;
+    const int  slot  =  (rnd  >>  16)  %  64;
+    if (live[slot])
+    {
+      pool->ffree(live[slot]);
+      live[slot]  =  nullptr;
+    } else {
+      live[slot]  =  pool->fmalloc(8  +  (rnd  >>  8)  %  1100);
+    }
+  }
+  for (auto  &&ptr  :  live)
+  {
+    if (ptr)  {  pool->ffree(ptr);  }
+  }
+}
+
+/**
+ * @brief test_rseq1
+ * @return
+ *  Testing per-CPU slots (DEF_Rseq_slots):
+ *  allocations of one CPU are cut one after another from its chunk, ffree/check_access
+ *  treat them as usual, after release_cpu_slots() every leaf comes back.
+ *  Without rseq the same goes through the leaves.
+ */
+bool test_rseq1()
+{
+  TRseqPool  *pool  =  new TRseqPool();
+  bool  re  =  true;
+  char  *ptr[3];
+  for (auto  &&it  :  ptr)
+  {
+    // (bigger than the headerless small objects)
+    it  =  static_cast<char *>(pool->fmalloc(300));
+    re  =  re  &&  it  &&  pool->check_access(it,  it  +  299,  1)  &&  !pool->check_access(it,  it  +  300,  1);
+  }
+  // cut downwards, the neighbours are one allocation apart (unless migrated meanwhile):
+  re  =  re  &&  ptr[1]  <  ptr[0]  &&  ptr[0]  -  ptr[1]  <=  400;
+  for (auto  &&it  :  ptr)
+  {
+    pool->ffree(it);
+  }
+  std::vector<std::thread>  threads;
+  for (int  i  =  0;  i  <  4;  ++i)
+  {
+    threads.emplace_back(slot_churn,  pool,  i);
+  }
+  for (auto  &&it  :  threads)
+  {
+    it.join();
+  }
+  pool->release_cpu_slots();
+  re  =  re  &&  8  ==  pool->get_free_leaves();
+  delete pool;
+  if (!re)
+  {
+    std::cerr << "test_rseq1: failed" << std::endl;
+  }
+  return  re;
+}
+#endif // DEF_Rseq_slots
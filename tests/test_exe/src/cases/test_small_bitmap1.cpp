@@ -0,0 +1,67 @@
+#include "fast_mem_pool.h"
+#include <algorithm>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#if defined(DEF_Small_bitmap)
+/**
+ * @brief test_small_bitmap1
+ * @return
+ *  Testing the bitmap engine of the headerless small objects (DEF_Small_bitmap):
+ *  one thread allocates while the other frees its objects, no object is given twice,
+ *  get_small_live() follows the bitmaps, a freed object is taken again
+ */
+bool test_small_bitmap1()
+{
+  FastMemPool<65536, 4, 1024, false, true>  memPool;
+  bool  re  =  true;
+  std::vector<char  *>  produced(4000,  nullptr);
+  std::atomic<int>  ready  {  0  };
+  std::thread  consumer([&]()  {
+    for (int  i  =  0;  i  <  4000;  ++i)
+    {
+      while (ready.load(std::memory_order_acquire)  <=  i)  {  std::this_thread::yield();  }
+      // odd objects are freed at once by the other thread:
+      if (i  &  1)  {  memPool.ffree(produced[i]);  }
+    }
+  });
+  for (int  i  =  0;  i  <  4000;  ++i)
+  {
+    produced[i]  =  static_cast<char  *>(memPool.fmalloc(48));
+    if (!produced[i])  {  re  =  false;  break;  }
+    memset(produced[i],  i  &  0xFF,  48);
+    ready.store(i  +  1,  std::memory_order_release);
+  }
+  if (!re)  {  ready.store(4000,  std::memory_order_release);  }
+  consumer.join();
+  if (re)
+  {
+    // the even ones are alive, each once and with its content:
+    std::vector<char  *>  alive;
+    for (int  i  =  0;  i  <  4000;  i  +=  2)
+    {
+      if ((i  &  0xFF)  !=  static_cast<unsigned char>(produced[i][47]))  {  re  =  false;  }
+      alive.push_back(produced[i]);
+    }
+    std::sort(alive.begin(),  alive.end());
+    re  =  re  &&  alive.end()  ==  std::adjacent_find(alive.begin(),  alive.end());
+    re  =  re  &&  2000  ==  memPool.get_small_live(48)  &&  0  ==  memPool.get_small_live(16);
+    // a freed bit is taken again, never a live object:
+    char  *low  =  alive.front();
+    memPool.ffree(low);
+    alive.erase(alive.begin());
+    char  *again  =  static_cast<char  *>(memPool.fmalloc(40));
+    re  =  re  &&  again  &&  !std::binary_search(alive.begin(),  alive.end(),  again);
+    re  =  re  &&  2000  ==  memPool.get_small_live(48);
+    if (again)  {  memPool.ffree(again);  }
+    for (auto  &&it  :  alive)  {  memPool.ffree(it);  }
+  }
+  re  =  re  &&  0  ==  memPool.get_small_live();
+  if (!re)
+  {
+    std::cerr << "test_small_bitmap1: failed, live " << memPool.get_small_live() << std::endl;
+  }
+  return  re;
+}
+#endif // DEF_Small_bitmap
@@ -1,5 +1,6 @@
 #include "fast_mem_pool.h"
 #include <unordered_map>
+#include <map>
 #include <string>
 #include <cstdlib>
 
@@ -17,7 +18,24 @@ bool test_stl_allocator2()
   std::unordered_map<int,  int, std::hash<int>, std::equal_to<int>, FastMemPoolAllocator<std::pair<const int,  int>> >  umap1;
 
   // runtime inject FastMemPoolAllocator:
-  std::unordered_map<int,  int>  umap2(1024, std::hash<int>(), std::equal_to<int>(),  FastMemPoolAllocator<std::pair<const int,  int>>());
+  using  TNodePool = FastMemPool<65536, 16, 1024, true, true>;
+  using  TNodeAllocator = FastMemPoolAllocator<std::pair<const int,  int>,  TNodePool>;
+  TNodePool  node_pool;
+  TNodePool  other_pool;
+  std::unordered_map<int,  int, std::hash<int>, std::equal_to<int>, TNodeAllocator>  umap2(1024, std::hash<int>(), std::equal_to<int>(),  TNodeAllocator(&node_pool));
+
+  // the rebound allocators (nodes, buckets) keep the injected pool:
+  {
+    const TNodeAllocator  node_allocator(&node_pool);
+    std::map<int,  int,  std::less<int>,  TNodeAllocator>  map1(node_allocator);
+    for (int  i = 0;  i < 100;  ++i)  {  map1.emplace(i,  i);  }
+    for (auto  &&it  :  map1)
+    {
+      if (!node_pool.owns(&it))  return false;
+    }
+    if (map1.get_allocator()  !=  umap2.get_allocator()
+        ||  map1.get_allocator()  ==  TNodeAllocator(&other_pool))  return false;
+  }
 
   bool  sw  =  false;
   for (int  i = 0;  keep_run  &&  i < 1000000;  ++i) {
@@ -13,9 +13,55 @@ extern bool  test_stl_allocator2();
 extern bool  test_random_access1();
 extern bool  test_base_usage();
 extern bool  test_memcontrol1();
+extern bool  test_leaf_recovery1();
+extern bool  test_provision1();
+extern bool  test_pool_object1();
+extern bool  test_pmr1();
+extern bool  test_node_allocator1();
+extern bool  test_at_least1();
+extern bool  test_arena1();
+extern bool  test_arena_mark1();
+extern bool  test_epoch1();
+extern bool  test_object_pool1();
 #if defined (DEF_Auto_deallocate)
 extern bool  test_auto_deallocate();
 #endif
+#if defined (DEF_Alloc_site)
+extern bool  test_alloc_site1();
+#endif
+#if defined (DEF_Heap_profile)
+extern bool  test_heap_profile1();
+#endif
+#if defined (DEF_Alloc_trace)
+extern bool  test_alloc_trace1();
+#endif
+#if defined (DEF_Contention_profile)
+extern bool  test_contention1();
+#endif
+#if defined (DEF_Leaf_mmap)
+extern bool  test_leaf_mmap1();
+#endif
+#if defined (DEF_Headerless_small)
+extern bool  test_headerless1();
+#endif
+#if defined (DEF_Small_bitmap)
+extern bool  test_small_bitmap1();
+#endif
+#if defined (DEF_NUMA)
+extern bool  test_numa1();
+#endif
+#if defined (DEF_Rseq_slots)
+extern bool  test_rseq1();
+#endif
+#if defined (DEF_Pool_registry)
+extern bool  test_registry1();
+#endif
+#if defined (DEF_Lifetime_groups)
+extern bool  test_lifetime1();
+#endif
+#if defined (DEF_Buddy_medium)
+extern bool  test_buddy1();
+#endif
 
 // For the convenience of a random choice, we will emplace these methods into a vector:
 using TestFun = std::function<bool(void)>;
@@ -86,6 +132,16 @@ int main(int argc, char** argv)
   vec_fun.emplace_back(test_allocator1);
   vec_fun.emplace_back(test_stl_allocator2);
   vec_fun.emplace_back(test_base_usage);
+  vec_fun.emplace_back(test_leaf_recovery1);
+  vec_fun.emplace_back(test_provision1);
+  vec_fun.emplace_back(test_pool_object1);
+  vec_fun.emplace_back(test_pmr1);
+  vec_fun.emplace_back(test_node_allocator1);
+  vec_fun.emplace_back(test_at_least1);
+  vec_fun.emplace_back(test_arena1);
+  vec_fun.emplace_back(test_arena_mark1);
+  vec_fun.emplace_back(test_epoch1);
+  vec_fun.emplace_back(test_object_pool1);
   if constexpr(DEF_Raise_Exeptions)
   {
     vec_fun.emplace_back(test_exception1);
@@ -93,6 +149,42 @@ int main(int argc, char** argv)
 #if defined (DEF_Auto_deallocate)
   vec_fun.emplace_back(test_auto_deallocate);
 #endif
+#if defined (DEF_Alloc_site)
+  vec_fun.emplace_back(test_alloc_site1);
+#endif
+#if defined (DEF_Heap_profile)
+  vec_fun.emplace_back(test_heap_profile1);
+#endif
+#if defined (DEF_Alloc_trace)
+  vec_fun.emplace_back(test_alloc_trace1);
+#endif
+#if defined (DEF_Contention_profile)
+  vec_fun.emplace_back(test_contention1);
+#endif
+#if defined (DEF_Leaf_mmap)
+  vec_fun.emplace_back(test_leaf_mmap1);
+#endif
+#if defined (DEF_Headerless_small)
+  vec_fun.emplace_back(test_headerless1);
+#endif
+#if defined (DEF_Small_bitmap)
+  vec_fun.emplace_back(test_small_bitmap1);
+#endif
+#if defined (DEF_NUMA)
+  vec_fun.emplace_back(test_numa1);
+#endif
+#if defined (DEF_Rseq_slots)
+  vec_fun.emplace_back(test_rseq1);
+#endif
+#if defined (DEF_Pool_registry)
+  vec_fun.emplace_back(test_registry1);
+#endif
+#if defined (DEF_Lifetime_groups)
+  vec_fun.emplace_back(test_lifetime1);
+#endif
+#if defined (DEF_Buddy_medium)
+  vec_fun.emplace_back(test_buddy1);
+#endif
 
   std::cout << "started " << threads << " threads for " << seconds << "seconds\n";
 
@@ -14,6 +14,7 @@
 #include <algorithm>
 #include <string.h>
 #include <stdexcept>
+#include <limits>
 #include <map>
 
 /*
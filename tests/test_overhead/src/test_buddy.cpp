@@ -0,0 +1,83 @@
+#include "fast_mem_pool.h"
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+/*
+ * Variable size frame buffers (4 KiB .. 36 KiB): Live_Frames buffers are alive,
+ * each round frees a random one of them and allocates the next.
+ * The bump leaves are pinned by the buffers that are still alive and the rest goes to OS malloc,
+ * with DEF_Buddy_medium a freed block is split or merged for the next buffer at once.
+ */
+using  TBuddyPool = FastMemPool<65536, 16, 1024, true, false>;
+
+static constexpr int  Live_Frames  {  24  };
+
+static int64_t  now_usec()
+{
+  return  std::chrono::duration_cast<std::chrono::microseconds>
+      (std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static std::size_t  frame_size(int  round)
+{
+  return  4096  +  static_cast<std::size_t>(round)  *  7919  %  32768;
+}
+
+// the buffer that is freed this round:
+static int  victim(int  round)
+{
+  return  static_cast<int>(((static_cast<uint64_t>(round)  *  2654435761u)  >>  7)  %  Live_Frames);
+}
+
+/**
+ * @brief test_buddy
+ * @param cnt  -  rounds
+ * @return
+ */
+bool test_buddy(int  cnt)
+{
+  std::cout << "\n\nFrame buffers 4 KiB .. 36 KiB, " << Live_Frames << " alive, a random one is replaced (" << cnt << " rounds, 1 MiB pool" <<
+#if defined(DEF_Buddy_medium)
+               "):"
+#else
+               ", DEF_Buddy_medium is off):"
+#endif
+            << "\n|  allocator      |\tOS malloc fallbacks|\tfree leaves after|\tusec|";
+  bool  re  =  true;
+  {
+    TBuddyPool  *pool  =  new TBuddyPool();
+    std::vector<void  *>  frames(Live_Frames,  nullptr);
+    int64_t  os_allocs  =  0;
+    const int64_t  start  =  now_usec();
+    for (int  round  =  0;  round  <  cnt;  ++round)
+    {
+      void  *&frame  =  frames[victim(round)];
+      if (frame)  {  pool->ffree(frame);  }
+      frame  =  pool->fmalloc(frame_size(round));
+      if (!pool->owns(frame))  {  ++os_allocs;  }
+      static_cast<char  *>(frame)[0]  =  1;
+    }
+    for (auto  &&it  :  frames)  {  if (it)  {  pool->ffree(it);  }  }
+    const int64_t  end  =  now_usec();
+    const int  free_leaves  =  pool->get_free_leaves();
+    re  =  16  ==  free_leaves;
+    std::cout << "\n|  FastMemPool    |\t" << os_allocs << "|\t" << free_leaves << "|\t" << (end  -  start) << "|";
+    delete pool;
+  }
+  {
+    std::vector<void  *>  frames(Live_Frames,  nullptr);
+    const int64_t  start  =  now_usec();
+    for (int  round  =  0;  round  <  cnt;  ++round)
+    {
+      void  *&frame  =  frames[victim(round)];
+      free(frame);
+      frame  =  malloc(frame_size(round));
+      static_cast<char  *>(frame)[0]  =  1;
+    }
+    for (auto  &&it  :  frames)  {  free(it);  }
+    const int64_t  end  =  now_usec();
+    std::cout << "\n|  malloc/free    |\t-|\t-|\t" << (end  -  start) << "|";
+  }
+  return  re;
+} // test_buddy
@@ -0,0 +1,74 @@
+#include "fast_mem_pool.h"
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <iostream>
+
+/*
+ * Multi threaded scaling of fmalloc/ffree on one shared pool:
+ * each thread churns its own window of live allocations, so the threads allocate and free
+ * in different leaves at the same time. Build with and without DEF_Cache_line_isolation
+ * to see the false sharing between neighbour leaves and cur_leaf.
+ */
+using  TScalingPool = FastMemPool<65536, 64, 1024, false, false>;
+
+static void  scaling_churn(TScalingPool  *pool,  int  seed,  int  cnt)
+{
+  void  *live[64]  =  {};
+  uint32_t  rnd  =  seed  *  2654435761u  +  1;
+  for (int  i  =  0;  i  <  cnt;  ++i)
+  {
+    rnd  =  rnd  *  1103515245u  +  12345u;
+    const int  slot  =  (rnd  >>  16)  %  64;
+    if (live[slot])
+    {
+      pool->ffree(live[slot]);
+    }
+    live[slot]  =  pool->fmalloc(16  +  (rnd  >>  8)  %  256);
+  }
+  for (auto  &&ptr  :  live)
+  {
+    if (ptr)  {  pool->ffree(ptr);  }
+  }
+}
+
+/**
+ * @brief test_leaf_scaling
+ * @param threads_cnt  -  max threads, the table goes 1, 2, 4 .. threads_cnt
+ * @param cnt  -  fmalloc/ffree pairs per thread
+ * @return
+ */
+bool test_leaf_scaling(int  threads_cnt,  int  cnt)
+{
+  TScalingPool  *pool  =  new TScalingPool();
+#if defined(DEF_Cache_line_isolation)
+  std::cout << "\n\nScaling (DEF_Cache_line_isolation), " << cnt << " fmalloc/ffree pairs per thread:";
+#else
+  std::cout << "\n\nScaling (packed leaves), " << cnt << " fmalloc/ffree pairs per thread:";
+#endif
+  std::cout << "\n|  threads|\tmsec|\tMpairs/sec|";
+  for (int  threads  =  1;  ;  threads  *=  2)
+  {
+    if (threads  >  threads_cnt)  {  threads  =  threads_cnt;  }
+    std::vector<std::thread>  vec_threads;
+    const int64_t  start  =  std::chrono::duration_cast<std::chrono::microseconds>
+        (std::chrono::steady_clock::now().time_since_epoch()).count();
+    for (int  n  =  0;  n  <  threads;  ++n)
+    {
+      vec_threads.emplace_back(scaling_churn,  pool,  n,  cnt);
+    }
+    for (auto  &&it  :  vec_threads)
+    {
+      it.join();
+    }
+    const int64_t  end  =  std::chrono::duration_cast<std::chrono::microseconds>
+        (std::chrono::steady_clock::now().time_since_epoch()).count();
+    const double  usec  =  static_cast<double>(std::max<int64_t>(end  -  start,  1));
+    std::cout << "\n|  " << threads << "|\t" << (end  -  start)  /  1000
+              << "|\t" << (static_cast<double>(threads)  *  cnt  /  usec) << "|";
+    if (threads  ==  threads_cnt)  {  break;  }
+  }
+  const bool  re  =  64  ==  pool->get_free_leaves();
+  delete pool;
+  return  re;
+} // test_leaf_scaling
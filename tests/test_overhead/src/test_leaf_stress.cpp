@@ -0,0 +1,101 @@
+#include "fast_mem_pool.h"
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <iostream>
+
+/*
+ * Long running stress of the leaf reservation:
+ * threads keep a window of live allocations and race for the tails of the leaves,
+ * every round all allocations are returned and the pool must get all leaves back.
+ * A leaf lost to the pool (never reset) shows up as falling free leaves and
+ * growing failed (nullptr) allocations, Do_OS_malloc is off so nothing is hidden by OS malloc.
+ */
+using  TStressPool = FastMemPool<65536, 64, 1024, false, false>;
+
+static void  stress_round(TStressPool  *pool,  int  seed,  int64_t  until_ms,
+  std::atomic<int64_t>  *allocs,  std::atomic<int64_t>  *failed)
+{
+  void  *live[256]  =  {};
+  uint32_t  rnd  =  seed  *  2654435761u  +  1;
+  int64_t  my_allocs  =  0;
+  int64_t  my_failed  =  0;
+  for (;;)
+  {
+    for (int  i  =  0;  i  <  4096;  ++i)
+    {
+      rnd  =  rnd  *  1103515245u  +  12345u;
+      const int  slot  =  (rnd  >>  16)  %  256;
+      if (live[slot])
+      {
+        pool->ffree(live[slot]);
+        live[slot]  =  nullptr;
+      } else {
+        live[slot]  =  pool->fmalloc(16  +  (rnd  >>  8)  %  1024);
+        ++my_allocs;
+        if (!live[slot])  {  ++my_failed;  }
+      }
+    }
+    if (std::chrono::duration_cast<std::chrono::milliseconds>
+        (std::chrono::steady_clock::now().time_since_epoch()).count()  >=  until_ms)
+    {
+      break;
+    }
+  }
+  for (auto  &&ptr  :  live)
+  {
+    if (ptr)  {  pool->ffree(ptr);  }
+  }
+  allocs->fetch_add(my_allocs,  std::memory_order_relaxed);
+  failed->fetch_add(my_failed,  std::memory_order_relaxed);
+}
+
+/**
+ * @brief test_leaf_stress
+ * @param threads_cnt  -  threads racing for the pool
+ * @param seconds  -  how long to run (hours are fine: a report line each minute)
+ * @return  -  true if the pool capacity stayed stable (all leaves came back after each round)
+ */
+bool test_leaf_stress(int  threads_cnt,  int64_t  seconds)
+{
+  TStressPool  *pool  =  new TStressPool();
+  const int64_t  start  =  std::chrono::duration_cast<std::chrono::milliseconds>
+      (std::chrono::steady_clock::now().time_since_epoch()).count();
+  const int64_t  finish  =  start  +  seconds  *  1000;
+  int64_t  next_report  =  start;
+  int64_t  rounds  =  0;
+  int  min_free_leaves  =  pool->get_free_leaves();
+  std::atomic<int64_t>  allocs  {  0  };
+  std::atomic<int64_t>  failed  {  0  };
+  std::cout << "\n\nLeaf stress (threads =" << threads_cnt << ", seconds =" << seconds << "):"
+            << "\n|  minute|\trounds|\tallocs|\tfailed|\tfree leaves|";
+  for (int64_t  now  =  start;  now  <  finish;  )
+  {
+    // one second rounds:
+    const int64_t  until  =  std::min(now  +  1000,  finish);
+    std::vector<std::thread>  vec_threads;
+    for (int  n  =  0;  n  <  threads_cnt;  ++n)
+    {
+      vec_threads.emplace_back(stress_round,  pool,  static_cast<int>(rounds  *  threads_cnt  +  n),  until,  &allocs,  &failed);
+    }
+    for (auto  &&it  :  vec_threads)
+    {
+      it.join();
+    }
+    ++rounds;
+    const int  free_leaves  =  pool->get_free_leaves();
+    min_free_leaves  =  std::min(min_free_leaves,  free_leaves);
+    now  =  std::chrono::duration_cast<std::chrono::milliseconds>
+        (std::chrono::steady_clock::now().time_since_epoch()).count();
+    if (now  >=  next_report  ||  now  >=  finish)
+    {
+      std::cout << "\n|  " << (now  -  start)  /  60000 << "|\t" << rounds << "|\t" << allocs.load()
+                << "|\t" << failed.load() << "|\t" << free_leaves << "/" << 64 << "|" << std::flush;
+      next_report  +=  60000;
+    }
+  }
+  delete pool;
+  std::cout << "\nLeaf stress: min free leaves after a round=" << min_free_leaves << "/64 "
+            << (64  ==  min_free_leaves  ?  "(capacity stable)"  :  "(LEAVES LOST)");
+  return  64  ==  min_free_leaves;
+} // test_leaf_stress
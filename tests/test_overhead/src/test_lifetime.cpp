@@ -0,0 +1,77 @@
+#include "fast_mem_pool.h"
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+/*
+ * Fragmentation by long living objects: every round keeps one small object for the next
+ * Long_Objects rounds (a cache entry) and allocates + frees a burst of short lived buffers.
+ * Without lifetime groups the cache entries land in every leaf the burst goes through,
+ * the pinned leaves never reset and the bursts go to OS malloc.
+ * With DEF_Lifetime_groups the hinted cache entries stay in the Long leaves.
+ */
+using  TLifetimePool = FastMemPool<65536, 16, 1024, true, false>;
+
+static constexpr int  Long_Objects  {  2000  };
+static constexpr int  Burst  {  64  };
+
+static int64_t  now_usec()
+{
+  return  std::chrono::duration_cast<std::chrono::microseconds>
+      (std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// OS malloc fallbacks of the short lived buffers:
+static int64_t  churn(TLifetimePool  *pool,  int  rounds,  bool  hinted)
+{
+  const TLifetimePool::LifetimeHint  long_hint  =  hinted  ?  TLifetimePool::LifetimeHint::Long  :  TLifetimePool::LifetimeHint::Medium;
+  const TLifetimePool::LifetimeHint  short_hint  =  hinted  ?  TLifetimePool::LifetimeHint::Short  :  TLifetimePool::LifetimeHint::Medium;
+  int64_t  os_allocs  =  0;
+  std::vector<void  *>  long_objects(Long_Objects,  nullptr);
+  void  *burst[Burst];
+  for (int  round  =  0;  round  <  rounds;  ++round)
+  {
+    void  *&entry  =  long_objects[round  %  Long_Objects];
+    if (entry)  {  pool->ffree(entry);  }
+    entry  =  pool->fmalloc(64,  long_hint);
+    for (int  i  =  0;  i  <  Burst;  ++i)
+    {
+      burst[i]  =  pool->fmalloc(256  +  (round  +  i)  %  768,  short_hint);
+      if (!pool->owns(burst[i]))  {  ++os_allocs;  }
+    }
+    for (int  i  =  0;  i  <  Burst;  ++i)  {  pool->ffree(burst[i]);  }
+  }
+  for (auto  &&it  :  long_objects)  {  if (it)  {  pool->ffree(it);  }  }
+  return  os_allocs;
+}
+
+/**
+ * @brief test_lifetime
+ * @param cnt  -  rounds
+ * @return
+ */
+bool test_lifetime(int  cnt)
+{
+  std::cout << "\n\nShort lived bursts next to long living objects (" << cnt << " rounds of " << Burst
+            << " buffers, 1 MiB pool" <<
+#if defined(DEF_Lifetime_groups)
+               "):"
+#else
+               ", DEF_Lifetime_groups is off, the hint is ignored):"
+#endif
+            << "\n|  fmalloc        |\tOS malloc fallbacks|\tfree leaves after|\tusec|";
+  bool  re  =  true;
+  for (bool  hinted  :  {false,  true})
+  {
+    TLifetimePool  *pool  =  new TLifetimePool();
+    const int64_t  start  =  now_usec();
+    const int64_t  os_allocs  =  churn(pool,  cnt,  hinted);
+    const int64_t  end  =  now_usec();
+    const int  free_leaves  =  pool->get_free_leaves();
+    re  =  re  &&  16  ==  free_leaves;
+    std::cout << "\n|  " << (hinted  ?  "(size, hint)  " :  "(size)        ") << "|\t" << os_allocs
+              << "|\t" << free_leaves << "|\t" << (end  -  start) << "|";
+    delete pool;
+  }
+  return  re;
+} // test_lifetime
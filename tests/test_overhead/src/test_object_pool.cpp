@@ -0,0 +1,82 @@
+#include "fast_object_pool.h"
+#include "specstack.h"
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+/*
+ * Object recycling: batches of objects are created and destroyed rounds times, one thread
+ * (SpecStackPool is single threaded). The object reserves a buffer in its constructor:
+ * new/delete and FastObjectPool pay it for each object, SpecStackPool and FastObjectPool
+ * with Cache_Constructed keep the constructed objects and only clear() them.
+ */
+using  TObjectPool = FastMemPool<1048576, 64, 1024, true, false>;
+
+static constexpr int  Batch  {  1000  };
+
+namespace {
+struct BenchObject {
+  BenchObject()  {  payload.reserve(32);  }
+  void  clear()  {  payload.clear();  id  =  0;  }
+  std::vector<int>  payload;
+  int64_t  id  {  0  };
+  // SpecStack link:
+  BenchObject  *nextIStack  {  nullptr  };
+};
+}
+
+static int64_t  now_usec()
+{
+  return  std::chrono::duration_cast<std::chrono::microseconds>
+      (std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template<class Create, class Destroy>
+static double  run_rounds(int  rounds,  Create  create,  Destroy  destroy)
+{
+  BenchObject  *objs[Batch];
+  const int64_t  start  =  now_usec();
+  for (int  round  =  0;  round  <  rounds;  ++round)
+  {
+    for (int  i  =  0;  i  <  Batch;  ++i)
+    {
+      objs[i]  =  create();
+      objs[i]->payload.push_back(i);
+      objs[i]->id  =  i;
+    }
+    for (int  i  =  0;  i  <  Batch;  ++i)  {  destroy(objs[i]);  }
+  }
+  return  (now_usec()  -  start)  /  1000.0;
+}
+
+/**
+ * @brief test_object_pool
+ * @param cnt  -  objects to create (in batches of 1000)
+ * @return
+ */
+bool test_object_pool(int  cnt)
+{
+  const int  rounds  =  std::max(1,  cnt  /  Batch);
+  std::cout << "\n\nObject recycling, " << rounds << " rounds of " << Batch << " objects, msec:"
+            << "\n|  new/delete               |\t" << run_rounds(rounds,
+                 []()  {  return  new BenchObject();  },  [](BenchObject  *obj)  {  delete  obj;  }) << "|";
+  {
+    SpecStackPool<BenchObject,  Batch>  stack_pool;
+    std::cout << "\n|  SpecStackPool            |\t" << run_rounds(rounds,
+                 [&stack_pool]()  {  return  stack_pool.get();  },  [&stack_pool](BenchObject  *obj)  {  stack_pool.recycle(obj);  }) << "|";
+  }
+  TObjectPool  *pool  =  new TObjectPool();
+  {
+    FastObjectPool<BenchObject,  TObjectPool>  objects(pool);
+    std::cout << "\n|  FastObjectPool           |\t" << run_rounds(rounds,
+                 [&objects]()  {  return  objects.create();  },  [&objects](BenchObject  *obj)  {  objects.destroy(obj);  }) << "|";
+  }
+  {
+    FastObjectPool<BenchObject,  TObjectPool,  true>  cached(pool);
+    std::cout << "\n|  FastObjectPool (cached)  |\t" << run_rounds(rounds,
+                 [&cached]()  {  return  cached.create();  },  [&cached](BenchObject  *obj)  {  obj->clear();  cached.destroy(obj);  }) << "|";
+  }
+  const bool  re  =  64  ==  pool->get_free_leaves();
+  delete  pool;
+  return  re;
+} // test_object_pool
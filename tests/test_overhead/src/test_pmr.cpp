@@ -0,0 +1,76 @@
+#include "fast_mem_pool.h"
+#include <chrono>
+#include <iostream>
+
+#if defined(FastMemPool_PMR)
+#include <list>
+#include <unordered_map>
+#include <string>
+
+/*
+ * std::pmr containers on FastMemPoolResource versus the standard resources:
+ * the containers are filled and destroyed rounds times, one thread (unsynchronized_pool_resource
+ * is single threaded), the pool resource is shared by all rounds like the standard pool resource.
+ */
+using  TPmrPool = FastMemPool<1048576, 256, 1024, true, false>;
+
+static int64_t  now_usec()
+{
+  return  std::chrono::duration_cast<std::chrono::microseconds>
+      (std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// list push_back + unordered_map emplace + pmr::string, then destruction:
+static int64_t  fill_containers(std::pmr::memory_resource  *resource,  int  cnt)
+{
+  int64_t  check  =  0;
+  std::pmr::list<int>  lst(resource);
+  std::pmr::unordered_map<int,  std::pmr::string>  umap(resource);
+  for (int  i  =  0;  i  <  cnt;  ++i)
+  {
+    lst.push_back(i);
+    umap.emplace(i,  "the value of the key is bigger than SSO buffer");
+  }
+  for (auto  &&it  :  umap)  {  check  +=  it.first  +  it.second.size();  }
+  return  check  +  lst.size();
+}
+#endif // FastMemPool_PMR
+
+/**
+ * @brief test_pmr
+ * @param cnt  -  elements in each container
+ * @return
+ */
+bool test_pmr(int  cnt)
+{
+#if defined(FastMemPool_PMR)
+  const int  rounds  =  10;
+  TPmrPool  *pool  =  new TPmrPool();
+  FastMemPoolResource<TPmrPool>  fast_resource(pool);
+  std::pmr::unsynchronized_pool_resource  unsync_resource;
+  std::pmr::synchronized_pool_resource  sync_resource;
+  const std::pair<std::pmr::memory_resource  *,  const char  *>  resources[]  =  {
+    {std::pmr::new_delete_resource(),  "new_delete_resource          "},
+    {&unsync_resource,  "unsynchronized_pool_resource "},
+    {&sync_resource,  "synchronized_pool_resource   "},
+    {&fast_resource,  "FastMemPoolResource          "}
+  };
+  int64_t  check  =  0;
+  std::cout << "\n\nstd::pmr list + unordered_map of " << cnt << " elements, "
+            << rounds << " rounds, msec:\n|  resource                     |\tmsec|";
+  for (auto  &&it  :  resources)
+  {
+    const int64_t  start  =  now_usec();
+    for (int  i  =  0;  i  <  rounds;  ++i)
+    {
+      check  +=  fill_containers(it.first,  cnt);
+    }
+    std::cout << "\n|  " << it.second << "|\t" << (now_usec()  -  start)  /  1000.0 << "|";
+  }
+  delete  pool;
+  return  check  >  0;
+#else
+  (void)cnt;
+  return  true;
+#endif // FastMemPool_PMR
+} // test_pmr
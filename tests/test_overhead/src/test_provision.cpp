@@ -0,0 +1,53 @@
+#include "fast_mem_pool.h"
+#include <chrono>
+#include <iostream>
+
+/*
+ * Startup time of the leaf provisioning policies on a 512 MiB pool:
+ * the constructor time and then the time of the first pass over the whole pool
+ * (here Eager and Lazy pay the page faults), construct + first pass is the time to steady state.
+ */
+using  TProvisionPool = FastMemPool<1048576, 512, 4096, false, false>;
+
+static int64_t  now_usec()
+{
+  return  std::chrono::duration_cast<std::chrono::microseconds>
+      (std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief test_provision
+ * @param threads_cnt  -  helper threads for FastMemPoolProvision::Pretouch
+ * @return
+ */
+bool test_provision(int  threads_cnt)
+{
+  static const std::pair<FastMemPoolProvision,  const char  *>  policies[]  =  {
+    {FastMemPoolProvision::Eager,  "Eager   "},
+    {FastMemPoolProvision::Lazy,  "Lazy    "},
+    {FastMemPoolProvision::Prefault,  "Prefault"},
+    {FastMemPoolProvision::Pretouch,  "Pretouch"}
+  };
+  bool  re  =  true;
+  std::cout << "\n\nStartup of 512 MiB pool (Pretouch threads =" << threads_cnt << "), msec:"
+            << "\n|  policy  |\tconstruct|\tfirst pass|\ttotal|";
+  for (auto  &&it  :  policies)
+  {
+    const int64_t  start  =  now_usec();
+    TProvisionPool  *pool  =  new TProvisionPool(it.first,  threads_cnt);
+    const int64_t  constructed  =  now_usec();
+    // first pass: 4 KiB allocations, each writes its page:
+    int64_t  cnt  =  0;
+    while (char  *ptr  =  static_cast<char  *>(pool->fmalloc(4096  -  64)))
+    {
+      ptr[0]  =  1;
+      ++cnt;
+    }
+    const int64_t  passed  =  now_usec();
+    re  =  re  &&  cnt  >  0;
+    std::cout << "\n|  " << it.second << "|\t" << (constructed  -  start)  /  1000.0
+              << "|\t" << (passed  -  constructed)  /  1000.0 << "|\t" << (passed  -  start)  /  1000.0 << "|";
+    delete pool;
+  }
+  return  re;
+} // test_provision
@@ -0,0 +1,105 @@
+#include "fast_mem_pool.h"
+#include <chrono>
+#include <iostream>
+#include <list>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * STL containers with std::allocator versus FastMemPoolAllocator (injected pool instance,
+ * the node allocators are rebound from it) and FastMemPoolNodeAllocator (header free nodes,
+ * a new node cache for each container): each container is filled with cnt elements
+ * and destroyed rounds times in one thread.
+ */
+using  TStlPool = FastMemPool<1048576, 256, 1024, true, false>;
+
+static int64_t  now_usec()
+{
+  return  std::chrono::duration_cast<std::chrono::microseconds>
+      (std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template<template<class> class TAlloc>
+struct StlContainers  {
+  using  TMap = std::map<int,  int,  std::less<int>,  TAlloc<std::pair<const int,  int>>>;
+  using  TSet = std::set<int,  std::less<int>,  TAlloc<int>>;
+  using  TUMap = std::unordered_map<int,  int,  std::hash<int>,  std::equal_to<int>,  TAlloc<std::pair<const int,  int>>>;
+  using  TList = std::list<int,  TAlloc<int>>;
+  using  TVector = std::vector<int,  TAlloc<int>>;
+
+  // msec of rounds fill + destroy for: map, set, unordered_map, list, vector
+  template<class TMakeAlloc>
+  static void  run(const char  *name,  int  cnt,  int  rounds,  TMakeAlloc  alloc)
+  {
+    int64_t  check  =  0;
+    std::cout << "\n|  " << name << "|\t";
+    int64_t  start  =  now_usec();
+    for (int  r  =  0;  r  <  rounds;  ++r)
+    {
+      TMap  container(std::less<int>(),  alloc());
+      for (int  i  =  0;  i  <  cnt;  ++i)  {  container.emplace(i,  i);  }
+      check  +=  container.size();
+    }
+    std::cout << (now_usec()  -  start)  /  1000.0 << "|\t";
+    start  =  now_usec();
+    for (int  r  =  0;  r  <  rounds;  ++r)
+    {
+      TSet  container(std::less<int>(),  alloc());
+      for (int  i  =  0;  i  <  cnt;  ++i)  {  container.insert(i);  }
+      check  +=  container.size();
+    }
+    std::cout << (now_usec()  -  start)  /  1000.0 << "|\t";
+    start  =  now_usec();
+    for (int  r  =  0;  r  <  rounds;  ++r)
+    {
+      TUMap  container(0,  std::hash<int>(),  std::equal_to<int>(),  alloc());
+      for (int  i  =  0;  i  <  cnt;  ++i)  {  container.emplace(i,  i);  }
+      check  +=  container.size();
+    }
+    std::cout << (now_usec()  -  start)  /  1000.0 << "|\t";
+    start  =  now_usec();
+    for (int  r  =  0;  r  <  rounds;  ++r)
+    {
+      TList  container(alloc());
+      for (int  i  =  0;  i  <  cnt;  ++i)  {  container.push_back(i);  }
+      check  +=  container.size();
+    }
+    std::cout << (now_usec()  -  start)  /  1000.0 << "|\t";
+    start  =  now_usec();
+    for (int  r  =  0;  r  <  rounds;  ++r)
+    {
+      TVector  container(alloc());
+      for (int  i  =  0;  i  <  cnt;  ++i)  {  container.push_back(i);  }
+      check  +=  container.size();
+    }
+    std::cout << (now_usec()  -  start)  /  1000.0 << "|" << (check  >  0  ?  ""  :  " failed");
+  }
+};
+
+template<class T>
+using  TStlAllocator = FastMemPoolAllocator<T,  TStlPool>;
+template<class T>
+using  TStlNodeAllocator = FastMemPoolNodeAllocator<T,  TStlPool>;
+
+/**
+ * @brief test_stl_containers
+ * @param cnt  -  elements in each container
+ * @return
+ */
+bool test_stl_containers(int  cnt)
+{
+  const int  rounds  =  10;
+  TStlPool  *pool  =  new TStlPool();
+  std::cout << "\n\nSTL containers of " << cnt << " elements, " << rounds << " rounds, msec:"
+            << "\n|  allocator                |\tmap|\tset|\tunordered_map|\tlist|\tvector|";
+  StlContainers<std::allocator>::run("std::allocator           ",  cnt,  rounds,
+    []()  {  return  std::allocator<int>();  });
+  StlContainers<TStlAllocator>::run("FastMemPoolAllocator     ",  cnt,  rounds,
+    [pool]()  {  return  TStlAllocator<int>(pool);  });
+  StlContainers<TStlNodeAllocator>::run("FastMemPoolNodeAllocator ",  cnt,  rounds,
+    [pool]()  {  return  TStlNodeAllocator<int>(pool);  });
+  delete  pool;
+  return  true;
+} // test_stl_containers
@@ -11,6 +11,14 @@
 extern bool test_fastmempool(int  cnt,  std::size_t each_size);
 extern bool test_mempool(int  cnt,  std::size_t each_size);
 extern bool test_OS_malloc(int  cnt,  std::size_t each_size);
+extern bool test_leaf_stress(int  threads_cnt,  int64_t  seconds);
+extern bool test_leaf_scaling(int  threads_cnt,  int  cnt);
+extern bool test_provision(int  threads_cnt);
+extern bool test_pmr(int  cnt);
+extern bool test_stl_containers(int  cnt);
+extern bool test_lifetime(int  cnt);
+extern bool test_object_pool(int  cnt);
+extern bool test_buddy(int  cnt);
 using TestFun = std::function<bool(int  cnt,  std::size_t each_size)>;
 
 
@@ -29,6 +37,18 @@ int main(int argc, char** argv)
     threads_cnt  = static_cast<int>(stoll(argv[1], static_cast<int>(strlen(argv[1]))));
     if (!threads_cnt)  threads_cnt  =  2;
   }
+  // Optional leaf stress duration (seconds), 0 == skip:
+  int64_t  stress_seconds  =  0;
+  if (argc > 2)
+  {
+    stress_seconds  =  stoll(argv[2], static_cast<int>(strlen(argv[2])));
+  }
+  // Optional test name filter (for example "OS_malloc"), only the matching tests are run:
+  std::string  filter;
+  if (argc > 3)
+  {
+    filter  =  argv[3];
+  }
   //std::cout << "\nMemory overhead for each allocation bytes=" << sizeof (FastMemPool<>::AllocHeader) << std::endl;
   struct AllocHeader {
     /*
@@ -46,8 +66,14 @@ int main(int argc, char** argv)
   std::map<std::string, TestFun> map_fun;
 
   std::cout << "\nMulti threaded (threads =" <<  threads_cnt  << "), msec for each count:";
-  map_fun.emplace("|  test_fastmempool           ", test_fastmempool);
-  map_fun.emplace("|  test_OS_malloc             ", test_OS_malloc);
+  auto  add_fun  =  [&](const std::string  &name,  TestFun  fun)  {
+    if (filter.empty()  ||  std::string::npos  !=  name.find(filter))
+    {
+      map_fun.emplace(name,  fun);
+    }
+  };
+  add_fun("|  test_fastmempool           ", test_fastmempool);
+  add_fun("|  test_OS_malloc             ", test_OS_malloc);
   std::cout << "\n---------------------------------------------------------------------------------"
                 << "\n|  test name, msec for allocs:|\t1000|\t10000|\t100000|\t1000000|"
                 << "\n---------------------------------------------------------------------------------";
@@ -78,7 +104,7 @@ int main(int argc, char** argv)
 
 
   std::cout << "\n\nSingle threaded times, msec:";
-  map_fun.emplace("|  test_mempool               ", test_mempool);
+  add_fun("|  test_mempool               ", test_mempool);
 
  //                          |  test name, msec for allocs:|
   std::cout << "\n---------------------------------------------------------------------------------"
@@ -98,6 +124,22 @@ int main(int argc, char** argv)
     }
   }
   std::cout << "\n---------------------------------------------------------------------------------";
+  if (!filter.empty())
+  {
+    std::cout << "\nAll tests done." << std::endl;
+    return 0;
+  }
+  test_leaf_scaling(threads_cnt,  1000000);
+  test_provision(threads_cnt);
+  test_pmr(100000);
+  test_stl_containers(100000);
+  test_lifetime(100000);
+  test_object_pool(1000000);
+  test_buddy(1000000);
+  if (stress_seconds  >  0)
+  {
+    test_leaf_stress(threads_cnt,  stress_seconds);
+  }
   std::cout << "\nAll tests done." << std::endl;
   return 0;
 }